@@ -2568,14 +2568,15 @@ static void assign_himem(void) {
 ** size of a file
 */
 static void assign_ext(void) {
-  int32 handle, newsize;
+  int32 handle;
+  int64 newsize;
   basicvars.current++;
   if (*basicvars.current!='#') error(ERR_HASHMISS);
   basicvars.current++;		/* Skip '#' token */
   handle = eval_intfactor();
   if (*basicvars.current!='=') error(ERR_EQMISS);
   basicvars.current++;
-  newsize = eval_integer();
+  newsize = eval_int64();
   if (!ateol[*basicvars.current]) error(ERR_SYNTAX);
   fileio_setext(handle, newsize);
 }
@@ -2760,14 +2761,15 @@ static void assign_page(void) {
 ** 'assign_ptr' deals with the Basic 'PTR#x=' statement
 */
 static void assign_ptr(void) {
-  int32 handle, newplace;
+  int32 handle;
+  int64 newplace;
   basicvars.current++;
   if (*basicvars.current=='#') {
   basicvars.current++;
   handle = eval_intfactor();
   if (*basicvars.current!='=') error(ERR_EQMISS);
   basicvars.current++;
-  newplace = eval_integer();
+  newplace = eval_int64();
   if (!ateol[*basicvars.current]) error(ERR_SYNTAX);
   fileio_setptr(handle, newplace);
   } else if (*basicvars.current=='(') {
@@ -507,6 +507,7 @@ typedef struct {
     unsigned int ignore_starcmd:1;	/* TRUE if built-in '*' commands are ignored */
     unsigned int startfullscreen:1;	/* TRUE if we start in fullscreen in SDL mode */
     unsigned int swsurface:1;		/* TRUE if we want a software surface */
+    unsigned int nocache:1;		/* TRUE if tokenised programs are not to be cached */
   } runflags;				/* Various runtime flags */
   struct {
     unsigned int enabled:1;   /* TRUE if any trace options are enabled */
@@ -557,12 +558,12 @@ typedef struct {
   int32 linecount;			/* Used when reading a Basic program or library into memory */
   variable staticvars[STDVARS];		/* Static integer variables @%-Z% */
   variable *varlists[VARLISTS];		/* Pointers to lists of variables, procedures and functions */
-  int64 centiseconds;			/* Centisecond timer, populated by sub-thread */
   int clocktype;			/* Type of clock used in centisecond timer */
   int64 monotonictimebase;		/* Baseline for OS_ReadMonotonicTime */
   size_t memdump_lastaddr;		/* Last address used by LISTB/LISTW */
+  size_t sysarrays[MAXSYSPARMS];	/* Size in bytes of array given as each SYS parameter, 0 if not an array */
+  uint32 sysfloats;		/* Bit n is set if SYS parameter n was a floating point value */
 #ifdef USE_SDL
-  SDL_Thread *csec_thread;	/* Holder for centisecond timer thread */
   SDL_Thread *interp_thread;	/* Holder for centisecond timer thread */
 #endif  
   char program[FNAMESIZE];		/* Name of program loaded */
@@ -590,6 +591,9 @@ typedef struct {
   uint32 legacyintmaths;      /* Legacy INT maths (BASIC I-V compatible) */
   uint32 cascadeiftweak;      /* Handle cascaded IFs the way BBCSDL does */
   boolean hex64;              /* Decode hex in 64-bit? */
+  boolean mapinput;           /* Map files opened with OPENIN into memory? */
+  boolean asyncconnect;       /* Return from OPENUP of a network connection before it is made? */
+  boolean fastformat;         /* Use fast number formatting code for PRINT and STR$? */
   boolean bitshift64;         /* Do bit shifts work in 64-bit space? */
   boolean pseudovarsunsigned; /* Unsigned pseudovars on 32-bit */
   boolean tekenabled;         /* Tektronix enabled in text mode (default: no) */
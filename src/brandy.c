@@ -37,12 +37,8 @@
 #include <pthread.h>
 #endif
 #endif /* USE_SDL */
-#ifndef TARGET_MINGW
-#include <sys/mman.h>
-#endif
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <fcntl.h>
 #include "common.h"
 #include "basicdefs.h"
 #include "tokens.h"
@@ -71,13 +67,12 @@ matrixbits matrixflags;		/* This contains flags used by Matrix Brandy extensions
 
 static void init1(void);
 static void init2(void);
-static void gpio_init(void);
+static void startup_mark(char *);
 #ifdef USE_SDL
 static int run_interpreter(void *);
 #else
 static void run_interpreter(void);
 #endif
-static void init_timer(void);
 static void init_clock(void);
 
 static char inputline[INPUTLEN];	/* Last line read */
@@ -92,6 +87,12 @@ static void check_cmdline(int, char *[]);
 static char *loadfile;			/* Pointer to name of file to load when interpreter starts */
 #endif
 
+#define MAXSTAGES 16			/* Most stages of startup that can be timed */
+
+static struct {char *stage; int64 when;} startup[MAXSTAGES];	/* Times at which each stage of startup finished */
+static int32 stagecount;		/* Number of stages timed so far */
+static boolean profilestart;		/* TRUE if startup times are to be shown */
+
 /*
 ** 'main' just starts things going. Control does not returns here after
 ** 'run_interpreter' is called. The program finishes when 'exec_quit'
@@ -100,17 +101,17 @@ static char *loadfile;			/* Pointer to name of file to load when interpreter sta
 
 int main(int argc, char *argv[]) {
   init1();
-  init_timer();	/* Initialise the timer thread */
 #ifndef NONET
   brandynet_init();
+  startup_mark("Networking");
 #endif
 #ifdef BRANDYAPP
   basicvars.runflags.quitatend = TRUE;
   basicvars.runflags.loadngo = TRUE;
 #endif
   check_cmdline(argc, argv);
+  startup_mark("Command line");
   init2();
-  gpio_init();
 #ifdef USE_SDL
   basicvars.interp_thread = SDL_CreateThread(run_interpreter,NULL);
   videoupdatethread();
@@ -155,7 +156,10 @@ static void init1(void) {
   basicvars.installist = NIL;
   basicvars.retcode = 0;
   init_clock();	/* Init to something sensible */
-  basicvars.monotonictimebase = basicvars.centiseconds;
+  basicvars.monotonictimebase = mos_centiseconds();
+  stagecount = 0;
+  profilestart = FALSE;
+  startup_mark("Start");
   basicvars.list_flags.space = FALSE;	/* Set initial listing options */
   basicvars.list_flags.indent = FALSE;
   basicvars.list_flags.split = FALSE;
@@ -200,6 +204,9 @@ static void init1(void) {
   matrixflags.legacyintmaths = 0;	/* Enable legacy integer maths? Default no = BASIC VI behaviour */
   matrixflags.cascadeiftweak = 1; /* Handle cascaded IFs BBCSDL-style? Default no = ARM BBC BASIC behaviour */
   matrixflags.hex64 = 0;		/* Decode hex as 64-bit? Default no = BASIC VI behaviour */
+  matrixflags.fastformat = 1;		/* Use fast number formatting? Default yes */
+  matrixflags.mapinput = 0;		/* Map OPENIN files into memory? Default no */
+  matrixflags.asyncconnect = 0;		/* Make network connections in the background? Default no */
   matrixflags.bitshift64 = 0;		/* Bit shifts operate in 64-bit space? Default no = BASIC VI behaviour */
   matrixflags.pseudovarsunsigned = 0;	/* Are memory pseudovariables unsigned on 32-bit? */
   matrixflags.tekenabled = 0;		/* Tektronix enabled in text mode (default: no) */
@@ -215,6 +222,8 @@ static void init1(void) {
 #endif
   matrixflags.printer = NULL;		/* By default, printer is closed */
   matrixflags.printer_ignore = 13;	/* By default, ignore carriage return characters */
+  matrixflags.gpio = 0;			/* GPIO interface is mapped on first use */
+  matrixflags.gpiomem = (byte *)-1;	/* Until then, it will internally return &FFFFFFFF */
 
 /*
  * Add dummy first parameter for Basic program command line.
@@ -223,30 +232,33 @@ static void init1(void) {
   add_arg("");
 }
 
-static void gpio_init() {
-#ifdef TARGET_UNIX
-  int fd;
-
-  matrixflags.gpio = 0;				/* Initialise the flag to 0 (not enabled) */
-  matrixflags.gpiomem = (byte *)-1;		/* Initialise, will internally return &FFFFFFFF */
-
-  fd=open("/dev/gpiomem", O_RDWR | O_SYNC);
-  if (fd == -1) return;				/* Couldn't open /dev/gpiomem - exit quietly */
+/*
+** 'startup_mark' notes the time at which stage 'stage' of starting
+** the interpreter finished. The times are listed by 'startup_report'
+** if the command line option '-profile' was used
+*/
+static void startup_mark(char *stage) {
+  if (stagecount == MAXSTAGES) return;
+  startup[stagecount].stage = stage;
+  startup[stagecount].when = mos_microseconds();
+  stagecount++;
+}
 
-  matrixflags.gpiomem=(byte *)mmap(NULL, 0x1000, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
-  close(fd);
-  if (matrixflags.gpiomem == MAP_FAILED) {
-    matrixflags.gpiomem = NULL;
-    return;
+/*
+** 'startup_report' lists how long each stage of starting the interpreter
+** took, in microseconds, and the time taken so far. It is called just
+** before the first statement is executed
+*/
+static void startup_report(void) {
+  int32 n;
+  if (!profilestart) return;
+  profilestart = FALSE;		/* Only report on the first run */
+  startup_mark("Total");
+  fprintf(stderr, "Startup time in microseconds:\n");
+  for (n = 1; n < stagecount; n++) {
+    fprintf(stderr, "  %-24s %8d %8d\n", startup[n].stage, (int32)(startup[n].when-startup[n-1].when),
+     (int32)(startup[n].when-startup[0].when));
   }
-  /* If we got here, mmap succeeded. */
-  matrixflags.gpio = 1;
-  matrixflags.gpiomemint=(uint32 *)matrixflags.gpiomem;
-#else
-  matrixflags.gpio = 0;				/* Initialise the flag to 0 (not enabled) */
-  matrixflags.gpiomem = (byte *)-1;		/* Initialise, will internally return &FFFFFFFF */
-#endif
-  return;
 }
 
 /*
@@ -257,11 +269,13 @@ static void init2(void) {
     cmderror(CMD_INITFAIL);	/* Initialisation failed */
     exit_interpreter(EXIT_FAILURE);	/* End run */
   }
+  startup_mark("Keyboard and screen");
   if (!init_heap() || !init_workspace(worksize)) {
     cmderror(CMD_NOMEMORY);	/* Not enough memory to run interpreter */
     kbd_quit();
     exit(EXIT_FAILURE);
   }
+  startup_mark("Workspace");
 #ifdef USE_SDL
   matrixflags.vdu14lines=0;
 #endif
@@ -271,6 +285,7 @@ static void init2(void) {
   basicvars.current = NIL;
   basicvars.misc_flags.validsaved = FALSE;		/* Want this to be 'FALSE' when the interpreter first starts */
   init_interpreter();
+  startup_mark("Interpreter");
 }
 
 /*
@@ -350,8 +365,12 @@ static void check_cmdline(int argc, char *argv[]) {
           }
         }
       }
+      else if (optchar == 'n' && tolower(*(p+2))=='o' && tolower(*(p+3))=='c')	/* -nocache  Do not cache tokenised programs */
+        basicvars.runflags.nocache = TRUE;
       else if (optchar == 'n' && tolower(*(p+2))=='o')	/* -nostar  Ignore '*' commands */
         basicvars.runflags.ignore_starcmd = TRUE;
+      else if (optchar=='p' && tolower(*(p+2))=='r')	/* -profile  Show time taken to start up */
+        profilestart = TRUE;
       else if (optchar=='p') {		/* -path */
         n++;
         if (n==argc)
@@ -455,7 +474,6 @@ static void load_libraries(void) {
 void init_clock() {
 #ifdef TARGET_RISCOS
   basicvars.clocktype = -1;
-  basicvars.centiseconds = clock();
 #else
   struct timespec tv;
   int result=1;
@@ -471,55 +489,9 @@ void init_clock() {
     fprintf(stderr, "init_clock: Unable to get a sensible timer, even realtime failed (which shouldn't happen)\n");
     exit(1);
   }
-  basicvars.centiseconds = (((uint64)tv.tv_sec * 100) + ((uint64)tv.tv_nsec / 10000000));
 #endif /* !TARGET_RISCOS */
 }
 
-#ifndef TARGET_RISCOS
-#ifdef USE_SDL
-static int timer_thread(void *data) {
-#else
-static void *timer_thread(void *data) {
-#endif
-  //struct timeval tv;
-  struct timespec tv;
-  while(1) {
-    clock_gettime(basicvars.clocktype, &tv);
-
-    /* tv.tv_sec  = Seconds */
-    // /* tv.tv_usec = and microseconds */
-    /* tv.tv_nsec = Nanoseconds */
-
-    //basicvars.centiseconds = (((uint64)tv.tv_sec * 100) + ((uint64)tv.tv_usec / 10000));
-    basicvars.centiseconds = (((uint64)tv.tv_sec * 100) + ((uint64)tv.tv_nsec / 10000000));
-    usleep(5000);
-  }
-  return 0;
-}
-#endif /* !TARGET_RISCOS */
-
-/* This function starts a timer thread */
-static void init_timer() {
-#ifndef TARGET_RISCOS
-#ifdef USE_SDL
-  basicvars.csec_thread = NULL;
-  basicvars.csec_thread = SDL_CreateThread(timer_thread,NULL);
-  if (basicvars.csec_thread == NULL) {
-    fprintf(stderr, "Timer thread failed to start\n");
-    exit(1);
-  }
-  //basicvars.video_thread = SDL_CreateThread(videoupdatethread,NULL);
-#else
-  pthread_t timer_thread_id;
-  int err = pthread_create(&timer_thread_id,NULL,&timer_thread,NULL);
-  if(err) {
-    fprintf(stderr,"Unable to create timer thread\n");
-    exit(1);
-  }
-#endif /* USE_SDL */
-#endif /* TARGET_RISCOS */
-}
-
 /*
 ** 'run_interpreter' is the main command loop for the interpreter.
 ** It reads commands and executes then. Control is also returned
@@ -534,11 +506,17 @@ static void run_interpreter(void) {
   if (sigsetjmp(basicvars.restart, 1)==0) {
     if (!basicvars.runflags.loadngo && !basicvars.runflags.outredir) announce();	/* Say who we are */
     init_errors();	/* Set up the signal handlers */
+    startup_mark("Signal handlers");
 #ifdef BRANDYAPP
     read_basic_block();
+    startup_mark("Program");
+    startup_report();
     run_program(basicvars.start);
 #else
-    if (liblist!=NIL) load_libraries();
+    if (liblist!=NIL) {
+      load_libraries();
+      startup_mark("Libraries");
+    }
     if (loadfile!=NIL) {	/*  Name of program to load was given on command line */
       read_basic(loadfile);
       init_expressions();
@@ -546,10 +524,13 @@ static void run_interpreter(void) {
       if (strlen(loadfile) < FNAMESIZE ) {
         strncpy(basicvars.program, loadfile, FNAMESIZE-1);	/* Save the name of the file */
       }
+      startup_mark("Program");
+      startup_report();
       if (basicvars.runflags.loadngo) run_program(basicvars.start);	/* Start program execution */
     }
 #endif
   }
+  startup_report();
 /* Control passes to this point in the event of an error via a 'siglongjmp' */
   while (TRUE) {
     read_command();
@@ -1018,6 +1018,8 @@ static void detailed_help(char *cmd) {
     emulate_printf("DIM [HIMEM] fred(100,100): create and initialise an array [off-heap].\r\nDIM fred%%%% [LOCAL] 100: allocate [temporary] space for a byte array etc\r\nDIM HIMEM fred%%%% 100: allocate off-heap space for a byte array etc\r\nDIM HIMEM fred%%%% -1: De-allocate memory reserved with DIM HIMEM (above)\r\nDIM(fred()): function gives the number of dimensions\r\nDIM(fred(),n): function gives the size of the n'th dimension.");
   } else if (!strcmp(cmd, "DIV")) {
     emulate_printf("Integer division, rounded towards zero, between two integers. Priority 3.");
+  } else if (!strcmp(cmd, "DOT(")) {
+    emulate_printf("DOT(<array>,<array>): gives the dot product of two numeric arrays with the same\r\nnumber of elements.");
   } else if (!strcmp(cmd, "DRAW")) {
     emulate_printf("DRAW [BY] x, y: graphics draw to [relative by] x, y.");
   } else if (!strcmp(cmd, "EDIT")) {
@@ -1121,6 +1123,10 @@ static void detailed_help(char *cmd) {
     emulate_printf("This pseudo-variable reads or sets the address of the start of the variables.");
   } else if (!strcmp(cmd, "LVAR")) {
     emulate_printf("This command lists all variables in use.");
+  } else if (!strcmp(cmd, "MAX(")) {
+    emulate_printf("MAX(<array>[,<flag>]): gives the largest element of a numeric array, or its\r\nindex if <flag> is non-zero.");
+  } else if (!strcmp(cmd, "MIN(")) {
+    emulate_printf("MIN(<array>[,<flag>]): gives the smallest element of a numeric array, or its\r\nindex if <flag> is non-zero.");
   } else if (!strcmp(cmd, "MID$(")) {
     emulate_printf("MID$(<string>,<position>): gives all of string starting from position.\r\nMID$(<string>,<position>,<count>): gives some of string from position.\r\nMID$(<string variable>,<position>[,<count>])=<string>: overwrite characters.");
   } else if (!strcmp(cmd, "MOD")) {
@@ -1200,7 +1206,7 @@ static void detailed_help(char *cmd) {
   } else if (!strcmp(cmd, "RIGHT$(")) {
     emulate_printf("RIGHT$(<string>,<number>): gives rightmost number of characters from string.\r\nRIGHT$(<string>): gives rightmost character.\r\nRIGHT$(<string variable>[,<count>])=<string>: overwrite characters at end.");
   } else if (!strcmp(cmd, "RND")) {
-    emulate_printf("RND: function gives a random integer.\r\nRND(n) where n<0: initialise random number generator based on n.\r\nRND(0): last RND(1) value.\r\nRND(1): random real 0..1.\r\nRND(n) where n>1: random value between 1 and INT(n).");
+    emulate_printf("RND: function gives a random integer.\r\nRND(n) where n<0: initialise random number generator based on n.\r\nRND(0): last RND(1) value.\r\nRND(1): random real 0..1.\r\nRND(n) where n>1: random value between 1 and INT(n).\r\nRND(array()[,n]): fill numeric array with random values, as RND(1) or RND(n).");
   } else if (!strcmp(cmd, "RUN")) {
     emulate_printf("Clear variables and start execution at beginning of program.");
   } else if (!strcmp(cmd, "SAVE")) {
@@ -1285,22 +1291,23 @@ ABS       ACS       ADVAL     AND       ASC       ASN       ATN       AUTO\r\n\
 APPEND    BEAT      BEATS     BGET      BPUT      CALL      CASE      CHAIN\r\n\
 CHR$      CIRCLE    CLEAR     CLG       CLOSE     CLS       COLOUR    COLOR\r\n\
 COS       COUNT     CRUNCH    DATA      DEF       DEG       DELETE    DIM\r\n\
-DIV       DRAW      EDIT      ELLIPSE   ELSE      END       ENDCASE   ENDIF\r\n\
-ENDPROC   ENDWHILE  ENVELOPE  EOF       EOR       ERL       ERR       ERROR\r\n\
-EVAL      EXP       EXT       FALSE     FILL      FN        FOR       GCOL\r\n\
-GET       GET$      GOSUB     GOTO      HELP      HIMEM     IF        INKEY\r\n\
-INKEY$    INPUT     INSTALL   INSTR(    INT       LEFT$(    LEN       LET\r\n\
-LIBRARY   LINE      LIST      LISTIF    LN        LOAD      LOCAL     LOG\r\n\
-LOMEM     LVAR      MID$(     MOD       MODE      MOUSE     MOVE      NEXT\r\n\
-NEW       NOT       OF        OFF       OLD       ON        OPENIN    OPENOUT\r\n\
-OPENUP    OR        ORIGIN    OSCLI     OTHERWISE OVERLAY   PAGE      PI\r\n\
-PLOT      POINT     POS       PRINT     PROC      PTR       QUIT      RAD\r\n\
-READ      RECTANGLE REM       RENUMBER  REPEAT    REPORT    RESTORE   RETURN\r\n\
-RIGHT$(   RND       RUN       SAVE      SGN       SIN       SOUND     SPC\r\n\
-SQR       STEP      STEREO    STOP      STR$      STRING$(  SUM       SWAP\r\n\
-SYS       TAB(      TAN       TEMPO     TEXTLOAD  TEXTSAVE  THEN      TIME\r\n\
-TINT      TO        TOP       TRACE     TRUE      UNTIL     USR       VAL\r\n\
-VDU       VOICE     VOICES    VPOS      WAIT      WHEN      WHILE     WIDTH");
+DIV       DOT(      DRAW      EDIT      ELLIPSE   ELSE      END       ENDCASE\r\n\
+ENDIF     ENDPROC   ENDWHILE  ENVELOPE  EOF       EOR       ERL       ERR\r\n\
+ERROR     EVAL      EXP       EXT       FALSE     FILL      FN        FOR\r\n\
+GCOL      GET       GET$      GOSUB     GOTO      HELP      HIMEM     IF\r\n\
+INKEY     INKEY$    INPUT     INSTALL   INSTR(    INT       LEFT$(    LEN\r\n\
+LET       LIBRARY   LINE      LIST      LISTIF    LN        LOAD      LOCAL\r\n\
+LOG       LOMEM     LVAR      MAX(      MID$(     MIN(      MOD       MODE\r\n\
+MOUSE     MOVE      NEXT      NEW       NOT       OF        OFF       OLD\r\n\
+ON        OPENIN    OPENOUT   OPENUP    OR        ORIGIN    OSCLI     OTHERWISE\r\n\
+OVERLAY   PAGE      PI        PLOT      POINT     POS       PRINT     PROC\r\n\
+PTR       QUIT      RAD       READ      RECTANGLE REM       RENUMBER  REPEAT\r\n\
+REPORT    RESTORE   RETURN    RIGHT$(   RND       RUN       SAVE      SGN\r\n\
+SIN       SOUND     SPC       SQR       STEP      STEREO    STOP      STR$\r\n\
+STRING$(  SUM       SWAP      SYS       TAB(      TAN       TEMPO     TEXTLOAD\r\n\
+TEXTSAVE  THEN      TIME      TINT      TO        TOP       TRACE     TRUE\r\n\
+UNTIL     USR       VAL       VDU       VOICE     VOICES    VPOS      WAIT\r\n\
+WHEN      WHILE     WIDTH");
   } else {
     emulate_printf("\r\nNo help available for '%s'", cmd);
   }
@@ -23,6 +23,8 @@
 **	character and binary format
 */
 
+#include <stdio.h>
+#include <string.h>
 #include <ctype.h>
 #include <math.h>
 #include "common.h"
@@ -44,6 +46,118 @@ int todigit(char x) {
 #define INTCONV (MAXINTVAL/10)
 #define INT64CONV (MAXINT64VAL/10)
 
+#define MAXFASTPOWER 22			/* Largest exact power of ten held as a float64 */
+#define MAXPARSEDIGITS 19		/* Most significant digits that fit in a uint64 */
+#define MAXINTDIGITS 18			/* Most digits always convertible to an int64 */
+#define MAXEXACTMANT 9007199254740992ull	/* 2**53 - Largest exact float64 mantissa */
+
+static const float64 powersoften[MAXFASTPOWER+1] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+** 'add_digits' appends the 'count' decimal digits at 'cp' to 'value'.
+** The caller has already checked that they are all digits and that
+** the result fits. On little-endian machines the digits are dealt
+** with eight at a time by loading them as a single 64-bit word and
+** combining them pairwise within it
+*/
+static uint64 add_digits(const char *cp, int32 count, uint64 value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__==__ORDER_LITTLE_ENDIAN__
+  uint64 chunk;
+  while (count>=8) {
+    memcpy(&chunk, cp, sizeof(chunk));
+    chunk-=0x3030303030303030ull;
+    chunk = (chunk*10)+(chunk>>8);
+    chunk = (((chunk & 0x000000FF000000FFull)*(100+(1000000ull<<32)))
+          + (((chunk>>16) & 0x000000FF000000FFull)*(1+(10000ull<<32))))>>32;
+    value = value*100000000ull+chunk;
+    cp+=8;
+    count-=8;
+  }
+#endif
+  while (count>0) {
+    value = value*10+(*cp-'0');
+    cp++;
+    count--;
+  }
+  return value;
+}
+
+/*
+** 'fast_decimal' is the fast path for 'tonumber' and 'todecimal'. It
+** deals with decimal integers of up to 18 digits and with floating
+** point numbers whose significant digits fit in a float64 mantissa
+** and whose decimal exponent is small enough that the power of ten is
+** also exact. The result then needs only one multiplication or
+** division, so it is correctly rounded. Anything else is left to the
+** digit-by-digit code, indicated by returning 'NIL'
+*/
+static char *fast_decimal(char *cp, boolean *isinteger, int32 *intvalue, int64 *int64value, float64 *floatvalue) {
+  char *numstart, *intstart, *pointstart, *fracstart, *expstart;
+  int32 intcount, exponent, expvalue;
+  uint64 mantissa;
+  boolean isneg, negexp;
+  float64 fpvalue;
+
+  isneg = *cp=='-';
+  if (*cp=='+' || *cp=='-') cp++;
+  numstart = cp;
+  while (*cp=='0') cp++;	/* Leading zeros do not count */
+  intstart = cp;
+  while (*cp>='0' && *cp<='9') cp++;
+  intcount = cp-intstart;
+  if (intcount>MAXPARSEDIGITS) return NIL;
+  mantissa = add_digits(intstart, intcount, 0);
+  if (*cp!='.' && !((*cp=='E' || *cp=='e') && !isalpha(*(cp+1)))) {	/* Plain integer */
+    if (cp==numstart || (intcount==MAXPARSEDIGITS && mantissa/10>=INT64CONV)) return NIL;
+    *intvalue = (int32)(isneg ? -(int64)mantissa : (int64)mantissa);
+    *int64value = isneg ? -(int64)mantissa : (int64)mantissa;
+    *isinteger = TRUE;
+    return cp;
+  }
+  exponent = 0;
+  if (*cp=='.') {
+    cp++;
+    pointstart = cp;
+    if (intcount==0) {
+      while (*cp=='0') cp++;	/* Nor do zeros straight after the point */
+    }
+    fracstart = cp;
+    while (*cp>='0' && *cp<='9') {	/* Fractions are usually short so just add the digits as they come */
+      mantissa = mantissa*10+(*cp-'0');
+      cp++;
+    }
+    if (cp==pointstart && intstart==numstart) return NIL;	/* No digits at all */
+    if (intcount+(cp-fracstart)>MAXPARSEDIGITS) return NIL;	/* 'mantissa' might have overflowed */
+    exponent = pointstart-cp;
+  }
+  else if (cp==numstart) return NIL;
+  if ((*cp=='E' || *cp=='e') && !isalpha(*(cp+1))) {
+    cp++;
+    negexp = *cp=='-';
+    if (*cp=='+' || *cp=='-') cp++;
+    expstart = cp;
+    expvalue = 0;
+    while (*cp>='0' && *cp<='9') {
+      expvalue = expvalue*10+(*cp-'0');
+      cp++;
+    }
+    if (cp-expstart>3) return NIL;
+    exponent+=(negexp ? -expvalue : expvalue);
+  }
+  if (exponent<-MAXFASTPOWER || exponent>MAXFASTPOWER || mantissa>MAXEXACTMANT) return NIL;
+  fpvalue = TOFLOAT(mantissa);
+  if (exponent<0)
+    fpvalue = fpvalue/powersoften[-exponent];
+  else
+    fpvalue = fpvalue*powersoften[exponent];
+  *floatvalue = (isneg ? -fpvalue : fpvalue);
+  *isinteger = FALSE;
+  return cp;
+}
+
 /*
 ** 'tonumber' converts the character string starting at 'cp' to binary.
 ** It handles integer and floating point values, including numbers
@@ -57,6 +171,7 @@ int todigit(char x) {
 char *tonumber(char *cp, boolean *isinteger, int32 *intvalue, int64 *int64value, float64 *floatvalue) {
   int32 value;
   int64 value64;
+  char *fastcp;
   static float64 fpvalue, fltdiv;
   boolean isint, isneg, negexp;
   int digits, exponent;
@@ -115,6 +230,11 @@ char *tonumber(char *cp, boolean *isinteger, int32 *intvalue, int64 *int64value,
     }
     break;
   default:	/* Integer or floating point value */
+    fastcp = fast_decimal(cp, isinteger, intvalue, int64value, floatvalue);
+    if (fastcp!=NIL) {
+      cp = fastcp;
+      break;
+    }
     isint = TRUE;
     isneg = *cp=='-';	/* Deal with any sign first */
     if (*cp=='+' || *cp=='-') cp++;
@@ -141,7 +261,7 @@ char *tonumber(char *cp, boolean *isinteger, int32 *intvalue, int64 *int64value,
     if (*cp=='.') {	/* Number contains a decimal point */
       if (isint) {
         isint = FALSE;
-        fpvalue = TOFLOAT(value);
+        fpvalue = TOFLOAT(value64);
       }
       fltdiv = 1.0;
       cp++;
@@ -160,7 +280,7 @@ char *tonumber(char *cp, boolean *isinteger, int32 *intvalue, int64 *int64value,
     if (toupper(*cp)=='E' && !isalpha(*(cp+1))) {	/* Number contains an exponent */
       if (isint) {
         isint = FALSE;
-        fpvalue = value;
+        fpvalue = TOFLOAT(value64);
       }
       exponent = 0;
       cp++;
@@ -211,6 +331,7 @@ char *tonumber(char *cp, boolean *isinteger, int32 *intvalue, int64 *int64value,
 char *todecimal(char *cp, boolean *isinteger, int32 *intvalue, int64 *int64value, float64 *floatvalue) {
   int32 value;
   int64 value64;
+  char *fastcp;
   static float64 fpvalue, fltdiv;
   boolean isint, isneg, negexp;
   int digits, exponent;
@@ -223,6 +344,8 @@ char *todecimal(char *cp, boolean *isinteger, int32 *intvalue, int64 *int64value
   fpvalue = 0;
   digits = 0;
   cp = skip_blanks(cp);	/* Ignore leading white space characters */
+  fastcp = fast_decimal(cp, isinteger, intvalue, int64value, floatvalue);
+  if (fastcp!=NIL) return fastcp;
   isint = TRUE;
   isneg = *cp=='-';	/* Deal with any sign first */
   if (*cp=='+' || *cp=='-') cp++;
@@ -249,7 +372,7 @@ char *todecimal(char *cp, boolean *isinteger, int32 *intvalue, int64 *int64value
   if (*cp=='.') {	/* Number contains a decimal point */
     if (isint) {
       isint = FALSE;
-      fpvalue = TOFLOAT(value);
+      fpvalue = TOFLOAT(value64);
     }
     fltdiv = 1.0;
     cp++;
@@ -268,7 +391,7 @@ char *todecimal(char *cp, boolean *isinteger, int32 *intvalue, int64 *int64value
   if (toupper(*cp)=='E' && !isalpha(*(cp+1))) {	/* Number contains an exponent */
     if (isint) {
       isint = FALSE;
-      fpvalue = value;
+      fpvalue = TOFLOAT(value64);
     }
     exponent = 0;
     cp++;
@@ -305,3 +428,235 @@ char *todecimal(char *cp, boolean *isinteger, int32 *intvalue, int64 *int64value
 #endif
   return cp;
 }
+
+/*
+** The following functions format numbers for 'PRINT' and 'STR$'. They
+** give exactly the same results as the C library's 'sprintf' with the
+** formats "%*.*G", "%*.*E" and "%*.*F" but avoid its cost for the
+** common cases, integer values and values that have a modest number
+** of significant digits, falling back on 'sprintf' for the rest
+*/
+
+#define MAXFASTDIGITS 15		/* Most significant digits the fast code produces */
+#define MAXFASTSCALED 1125899906842624.0	/* 2**50 - Largest scaled value handled */
+
+static const char digitpairs[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+/*
+** 'write_digits' stores the decimal digits of 'value' at 'cp', two
+** digits at a time, returning the number of digits
+*/
+static int32 write_digits(char *cp, uint64 value) {
+  char temp[20], *tp;
+  int32 length;
+  tp = temp+sizeof(temp);
+  while (value >= 100) {
+    int32 pair = (int32)(value%100)*2;
+    value = value/100;
+    tp-=2;
+    tp[0] = digitpairs[pair];
+    tp[1] = digitpairs[pair+1];
+  }
+  if (value >= 10) {
+    tp-=2;
+    tp[0] = digitpairs[value*2];
+    tp[1] = digitpairs[value*2+1];
+  }
+  else {
+    *--tp = '0'+(char)value;
+  }
+  length = temp+sizeof(temp)-tp;
+  memcpy(cp, tp, length);
+  return length;
+}
+
+/*
+** 'round_scaled' rounds 'value' multiplied by ten to the power 'scale'
+** to the nearest integer, storing the result at 'result'. It returns
+** FALSE if the result cannot be guaranteed to be the same as the one
+** that would be obtained from the exact binary value, that is, if the
+** scaled value is too large to be held exactly or lies too close to
+** half way between two integers. The product is correctly rounded as
+** the power of ten is exact, so it is within 2**-53 of the exact value
+*/
+static boolean round_scaled(float64 value, int32 scale, uint64 *result) {
+  float64 scaled, whole, fraction;
+  if (scale > MAXFASTPOWER || scale < -MAXFASTPOWER) return FALSE;
+  scaled = scale >= 0 ? value*powersoften[scale] : value/powersoften[-scale];
+  if (scaled >= MAXFASTSCALED) return FALSE;
+  whole = floor(scaled);
+  fraction = scaled-whole;
+  if (fabs(fraction-0.5) <= ldexp(scaled, -50)) return FALSE;	/* Too close to call */
+  *result = (uint64)whole+(fraction > 0.5);
+  return TRUE;
+}
+
+/*
+** 'get_digits' finds the first 'count' significant digits of the
+** positive, non-zero value 'value', correctly rounded, returning them
+** as an integer at 'digits' and the decimal exponent of the first of
+** them at 'exponent'. It returns FALSE if it cannot do this reliably
+*/
+static boolean get_digits(float64 value, int32 count, uint64 *digits, int32 *exponent) {
+  int32 power, attempt;
+  uint64 low, high, result;
+  if (count < 1 || count > MAXFASTDIGITS) return FALSE;
+  low = (uint64)powersoften[count-1];
+  high = (uint64)powersoften[count];
+  power = (int32)floor(log10(value));
+  for (attempt = 0; attempt < 3; attempt++) {	/* 'log10' can be one out and rounding can carry into a new digit */
+    if (!round_scaled(value, count-1-power, &result)) return FALSE;
+    if (result >= low && result < high) {
+      *digits = result;
+      *exponent = power;
+      return TRUE;
+    }
+    power = result < low ? power-1 : power+1;
+  }
+  return FALSE;
+}
+
+/*
+** 'write_exponent' adds a C-style exponent, 'E' followed by a sign and
+** at least two digits, to the number at 'cp'. It returns the number of
+** characters added
+*/
+static int32 write_exponent(char *cp, int32 exponent) {
+  cp[0] = 'E';
+  cp[1] = exponent < 0 ? '-' : '+';
+  if (exponent < 0) exponent = -exponent;
+  if (exponent < 10) {
+    cp[2] = '0';
+    cp[3] = '0'+exponent;
+    return 4;
+  }
+  return 2+write_digits(cp+2, exponent);
+}
+
+/*
+** 'strip_zeros' removes trailing zeros after the decimal point of the
+** number of length 'length' at 'cp', and the decimal point too if no
+** digits are left after it, as '%G' does. It returns the new length
+*/
+static int32 strip_zeros(char *cp, int32 length) {
+  if (memchr(cp, '.', length) == NIL) return length;
+  while (cp[length-1] == '0') length--;
+  if (cp[length-1] == '.') length--;
+  return length;
+}
+
+/*
+** 'fast_format' carries out the formatting for 'format_float' when it
+** can. It returns the length of the result or -1 if 'sprintf' has to
+** be used instead
+*/
+static int32 fast_format(char *cp, int32 style, int32 precision, float64 value) {
+  char digitbuf[24];
+  uint64 digits;
+  int32 exponent, count, length, n;
+  length = 0;
+  if (signbit(value)) {
+    cp[length++] = '-';
+    value = -value;
+  }
+  switch (style) {
+  case FORMAT_F:
+    if (value == 0.0)
+      digits = 0;
+    else if (!round_scaled(value, precision, &digits)) return -1;
+    count = write_digits(digitbuf, digits);
+    if (count <= precision) {	/* Add leading zeros so that there is at least one digit before the '.' */
+      memmove(digitbuf+precision+1-count, digitbuf, count);
+      memset(digitbuf, '0', precision+1-count);
+      count = precision+1;
+    }
+    memcpy(cp+length, digitbuf, count-precision);
+    length+=count-precision;
+    if (precision > 0) {
+      cp[length++] = '.';
+      memcpy(cp+length, digitbuf+count-precision, precision);
+      length+=precision;
+    }
+    return length;
+  case FORMAT_E:
+    if (value == 0.0) {
+      digits = 0;
+      exponent = 0;
+      memset(digitbuf, '0', precision+1);
+    }
+    else {
+      if (!get_digits(value, precision+1, &digits, &exponent)) return -1;
+      write_digits(digitbuf, digits);
+    }
+    cp[length++] = digitbuf[0];
+    if (precision > 0) {
+      cp[length++] = '.';
+      memcpy(cp+length, digitbuf+1, precision);
+      length+=precision;
+    }
+    return length+write_exponent(cp+length, exponent);
+  default:	/* FORMAT_G */
+    if (precision == 0) precision = 1;
+    if (value == floor(value) && precision <= MAXFASTPOWER && value < powersoften[precision]) {	/* Integer - Printed without '.' or exponent */
+      return length+write_digits(cp+length, (uint64)value);
+    }
+    if (!get_digits(value, precision, &digits, &exponent)) return -1;
+    count = write_digits(digitbuf, digits);
+    if (exponent < -4 || exponent >= precision) {	/* Use exponent form */
+      cp[length] = digitbuf[0];
+      cp[length+1] = '.';
+      memcpy(cp+length+2, digitbuf+1, count-1);
+      length = strip_zeros(cp, length+count+1);
+      return length+write_exponent(cp+length, exponent);
+    }
+    if (exponent < 0) {	/* Value is less than one */
+      cp[length++] = '0';
+      cp[length++] = '.';
+      for (n = exponent+1; n < 0; n++) cp[length++] = '0';
+      memcpy(cp+length, digitbuf, count);
+      length+=count;
+    }
+    else {
+      memcpy(cp+length, digitbuf, exponent+1);
+      length+=exponent+1;
+      cp[length++] = '.';
+      memcpy(cp+length, digitbuf+exponent+1, count-exponent-1);
+      length+=count-exponent-1;
+    }
+    return strip_zeros(cp, length);
+  }
+}
+
+/*
+** 'format_float' formats 'value' as the C library function 'sprintf'
+** would using the format "%*.*G", "%*.*E" or "%*.*F", as given by
+** 'style', with field width 'width' and precision 'precision'. The
+** result is stored at 'cp' and its length returned. The fast code can
+** be turned off using the SYS call 'Brandy_FastFormat'
+*/
+int32 format_float(char *cp, int32 style, int32 width, int32 precision, float64 value) {
+  int32 length;
+  if (matrixflags.fastformat && isfinite(value)) {
+    length = fast_format(cp, style, precision, value);
+    if (length >= 0) {
+      if (length < width) {	/* Right justify the value in the field */
+        memmove(cp+width-length, cp, length);
+        memset(cp, ' ', width-length);
+        length = width;
+      }
+      cp[length] = asc_NUL;
+      return length;
+    }
+  }
+  switch (style) {
+  case FORMAT_E:
+    return sprintf(cp, "%*.*E", width, precision, value);
+  case FORMAT_F:
+    return sprintf(cp, "%*.*F", width, precision, value);
+  default:
+    return sprintf(cp, "%*.*G", width, precision, value);
+  }
+}
@@ -31,5 +31,6 @@
 int todigit(char);
 char *tonumber(char *, boolean *, int32 *, int64 *, float64 *);
 char *todecimal(char *, boolean *, int32 *, int64 *, float64 *);
+int32 format_float(char *, int32, int32, int32, float64);
 
 #endif
@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <ctype.h>
@@ -52,6 +53,18 @@
 # include <zlib.h>
 #endif
 
+#ifdef TARGET_UNIX
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <dirent.h>
+#include <time.h>
+#define TOKCACHE
+#endif
+
 #define MARKERSIZE 4
 #define ENDMARKSIZE 8		/* Size of the sentinel value at the end of the program */
 
@@ -495,6 +508,247 @@ static int32 read_bbcfile(FILE *bbcfile, byte *base, byte *limit, int32 ftype) {
   return ALIGN(base - filebase + ENDMARKSIZE);
 }
 
+#ifdef TOKCACHE
+/*
+** Programs and libraries in text form are tokenised each time they are
+** read. To save doing this every time a program is run, a copy of the
+** tokenised program is kept in a cache directory, by default
+** '~/.cache/brandy'. The name of the cache file is made from the full
+** name of the source file. The cached copy is used only if the size,
+** modification time and inode of the source file, the version of the
+** interpreter, the checksum of its keyword table made by
+** 'token_checksum' and the options that affect tokenising all match.
+** A cache file's modification time is brought up to date when it is
+** used, at most once a day, and files that have not been used for
+** TOKCACHE_MAXAGE days are removed whenever a new one is written.
+** Libraries loaded with INSTALL are mapped straight from the cache file
+** into memory as a private mapping. All the copies of the interpreter
+** using a library then share the same pages, except for those pages
+** where tokens have been altered as the library is run, which become
+** private to the process that altered them
+*/
+#define TOKCACHE_FORMAT 3		/* Version of cache file layout and tokenised form */
+#define TOKCACHE_MAXAGE 30		/* Days after which an unused cache file is removed */
+#define TOKCACHE_DAY (24*60*60)		/* Seconds in a day */
+#define TOKCACHE_HASHBANG 1		/* Flag: program started with a '#' line */
+#define TOKCACHE_RENUMBERED 2		/* Flag: line numbers were added to program */
+#define TOKCACHE_HEX64 1		/* Option: 64-bit hex constants in effect */
+#define TOKCACHE_INDENT 2		/* Option: LISTO indent in effect */
+
+typedef struct {
+  char magic[8];			/* Identifies file as a cache file */
+  char version[128];			/* Version of interpreter that wrote file */
+  int32 format;				/* TOKCACHE_FORMAT */
+  int32 options;			/* Options that affect tokenising */
+  int32 pathlen;			/* Length of name of source file that follows header */
+  int64 size;				/* Size of source file */
+  int64 mtime;				/* Modification time of source file in seconds... */
+  int64 mtimensec;			/* ... and nanoseconds */
+  int64 inode;				/* Inode number of source file */
+  int32 flags;				/* Side effects of reading source file */
+  int32 length;				/* Size of tokenised program that follows name */
+} tokcacheheader;
+
+static char tokcachemagic[8] = {'B', 'r', 'a', 'n', 'd', 'y', 'T', 'C'};
+
+/* Offset of the tokenised program in a cache file, aligned so that it can be used in place */
+#define TOKCACHE_OFFSET(pathlen) ALIGN(sizeof(tokcacheheader)+(pathlen))
+
+/*
+** 'tokcache_header' fills in the cache file header for the source file
+** open as 'textfile' and puts the name of its cache file in 'cachename'.
+** It returns FALSE if the file cannot be cached
+*/
+static boolean tokcache_header(FILE *textfile, tokcacheheader *hp, char *realname, char *cachename) {
+  struct stat info;
+  char *home, *dir;
+  uint64 hashvalue = 14695981039346656037ull;
+  int n;
+
+  if (basicvars.runflags.nocache || fstat(fileno(textfile), &info) == -1 || !S_ISREG(info.st_mode)) return FALSE;
+  if (realpath(basicvars.filename, realname) == NIL) return FALSE;
+  dir = getenv("XDG_CACHE_HOME");
+  home = getenv("HOME");
+  if (dir != NIL && *dir != asc_NUL)
+    snprintf(cachename, PATH_MAX, "%s/brandy", dir);
+  else if (home != NIL && *home != asc_NUL)
+    snprintf(cachename, PATH_MAX, "%s/.cache/brandy", home);
+  else {
+    return FALSE;
+  }
+  for (n=0; realname[n] != asc_NUL; n++) hashvalue = (hashvalue ^ (byte)realname[n]) * 1099511628211ull;
+  n = strlen(cachename);
+  snprintf(cachename+n, PATH_MAX-n, "/%016llx.tok", (unsigned long long)hashvalue);
+  memset(hp, 0, sizeof(tokcacheheader));
+  memcpy(hp->magic, tokcachemagic, sizeof(tokcachemagic));
+#ifdef BRANDY_GITCOMMIT
+  snprintf(hp->version, sizeof(hp->version), "%s %s %08x", IDSTRING, BRANDY_GITCOMMIT, token_checksum());
+#else
+  snprintf(hp->version, sizeof(hp->version), "%s %08x", IDSTRING, token_checksum());
+#endif
+  hp->format = TOKCACHE_FORMAT;
+  hp->options = (matrixflags.hex64 ? TOKCACHE_HEX64 : 0) | (basicvars.list_flags.indent ? TOKCACHE_INDENT : 0);
+  hp->pathlen = strlen(realname);
+  hp->size = info.st_size;
+  hp->mtime = info.st_mtime;
+#ifdef TARGET_MACOSX
+  hp->mtimensec = info.st_mtimespec.tv_nsec;
+#else
+  hp->mtimensec = info.st_mtim.tv_nsec;
+#endif
+  hp->inode = info.st_ino;
+  return TRUE;
+}
+
+/*
+** 'open_tokcache' opens cache file 'cachename' and checks that it holds
+** the tokenised version of the source file described by 'header'. It
+** returns the handle of the file, with its header in 'cached', or -1
+** if the cache file is missing or out of date
+*/
+static int open_tokcache(tokcacheheader *header, char *realname, char *cachename, tokcacheheader *cached) {
+  char cachedname[PATH_MAX];
+  int handle;
+
+  handle = open(cachename, O_RDONLY);
+  if (handle == -1) return -1;
+  if (read(handle, cached, sizeof(tokcacheheader)) == sizeof(tokcacheheader)
+   && memcmp(cached, header, offsetof(tokcacheheader, flags)) == 0
+   && cached->length > 0 && cached->pathlen < PATH_MAX
+   && read(handle, cachedname, cached->pathlen) == cached->pathlen
+   && memcmp(cachedname, realname, cached->pathlen) == 0) {
+    struct stat info;
+    if (fstat(handle, &info) == 0 && time(NIL)-info.st_mtime > TOKCACHE_DAY) futimens(handle, NIL);	/* Note that it is in use */
+    return handle;
+  }
+  close(handle);
+  return -1;
+}
+
+/*
+** 'used_tokcache' repeats the side effects of reading the source of a
+** program when its tokenised version is taken from the cache instead
+*/
+static void used_tokcache(tokcacheheader *cached, char *cachename) {
+  matrixflags.scrunge = FALSE;
+  if (cached->flags & TOKCACHE_HASHBANG) basicvars.runflags.quitatend=basicvars.runflags.loadngo;
+  needsnumbers = (cached->flags & TOKCACHE_RENUMBERED) != 0;
+  if (needsnumbers && !basicvars.runflags.loadngo) emulate_printf("Line numbers added to program\r\n");
+  if (basicvars.debug_flags.debug) fprintf(stderr, "Read tokenised program from '%s'\n", cachename);
+}
+
+/*
+** 'read_tokcache' reads the tokenised version of a program from cache
+** file 'cachename' into memory at 'base' if the file is there and is
+** for the same version of the source as 'header'. It returns the size
+** of the program or zero if the cache cannot be used
+*/
+static int32 read_tokcache(tokcacheheader *header, char *realname, char *cachename, byte *base, byte *limit) {
+  tokcacheheader cached;
+  int handle;
+  boolean ok;
+
+  handle = open_tokcache(header, realname, cachename, &cached);
+  if (handle == -1) return 0;
+  ok = cached.length < limit-base
+    && lseek(handle, TOKCACHE_OFFSET(cached.pathlen), SEEK_SET) != -1
+    && read(handle, base, cached.length) == cached.length;
+  close(handle);
+  if (!ok) return 0;
+  used_tokcache(&cached, cachename);
+  return cached.length;
+}
+
+/*
+** 'map_tokcache' maps the tokenised version of the library open as
+** 'libfile' into memory from its cache file, returning its address and
+** setting '*size' to its size. It returns NIL if there is no usable
+** cache file, in which case the library has to be read in the usual way
+*/
+static byte *map_tokcache(FILE *libfile, int32 *size) {
+  tokcacheheader header, cached;
+  char realname[PATH_MAX], cachename[PATH_MAX];
+  size_t offset;
+  void *mapping;
+  int handle;
+
+  if (!tokcache_header(libfile, &header, realname, cachename)) return NIL;
+  handle = open_tokcache(&header, realname, cachename, &cached);
+  if (handle == -1) return NIL;
+  offset = TOKCACHE_OFFSET(cached.pathlen);
+  mapping = mmap(NIL, offset+cached.length, PROT_READ|PROT_WRITE, MAP_PRIVATE, handle, 0);
+  close(handle);		/* The mapping stays in place after the file is closed */
+  if (mapping == MAP_FAILED) return NIL;
+  used_tokcache(&cached, cachename);
+  *size = cached.length;
+  return (byte *)mapping+offset;
+}
+
+/*
+** 'prune_tokcache' removes cache files in directory 'cachedir' that
+** have not been used for TOKCACHE_MAXAGE days, so that the cache does
+** not keep growing as programs are deleted or renamed
+*/
+static void prune_tokcache(char *cachedir) {
+  DIR *dir;
+  struct dirent *entry;
+  struct stat info;
+  time_t oldest;
+  size_t length;
+
+  dir = opendir(cachedir);
+  if (dir == NIL) return;
+  oldest = time(NIL)-(time_t)TOKCACHE_MAXAGE*TOKCACHE_DAY;
+  while ((entry = readdir(dir)) != NIL) {
+    length = strlen(entry->d_name);
+    if (length < 4 || strcmp(entry->d_name+length-4, ".tok") != 0) continue;
+    if (fstatat(dirfd(dir), entry->d_name, &info, AT_SYMLINK_NOFOLLOW) == 0
+     && S_ISREG(info.st_mode) && info.st_mtime < oldest) unlinkat(dirfd(dir), entry->d_name, 0);
+  }
+  closedir(dir);
+}
+
+/*
+** 'write_tokcache' saves a copy of the newly-tokenised program at 'base'
+** in cache file 'cachename'. It is written to a temporary file first
+** so that another copy of the interpreter never sees a partly-written
+** file. Any problems just mean that the program is not cached
+*/
+static void write_tokcache(tokcacheheader *header, char *realname, char *cachename, byte *base, int32 length) {
+  char tempname[PATH_MAX+32];
+  char *dirend;
+  int handle;
+  boolean ok;
+  size_t padlen;
+  static byte padding[ALIGN(1)];
+
+  header->length = length;
+  padlen = TOKCACHE_OFFSET(header->pathlen)-sizeof(tokcacheheader)-header->pathlen;
+  dirend = strrchr(cachename, '/');	/* Create cache directory and its parent if need be */
+  *dirend = asc_NUL;
+  if (mkdir(cachename, 0700) == -1 && errno == ENOENT) {
+    char *parentend = strrchr(cachename, '/');
+    *parentend = asc_NUL;
+    mkdir(cachename, 0700);
+    *parentend = '/';
+    mkdir(cachename, 0700);
+  }
+  *dirend = '/';
+  snprintf(tempname, sizeof(tempname), "%s.%ld", cachename, (long)getpid());
+  handle = open(tempname, O_WRONLY|O_CREAT|O_TRUNC, 0600);
+  if (handle == -1) return;
+  ok = write(handle, header, sizeof(tokcacheheader)) == sizeof(tokcacheheader)
+    && write(handle, realname, header->pathlen) == header->pathlen
+    && write(handle, padding, padlen) == padlen
+    && write(handle, base, length) == length;
+  if (close(handle) == -1) ok = FALSE;
+  if (!ok || rename(tempname, cachename) == -1) remove(tempname);
+  *dirend = asc_NUL;
+  prune_tokcache(cachename);
+  *dirend = '/';
+}
+#endif /* TOKCACHE */
+
 /*
 ** 'read_textfile' reads a Basic program that is in text form,
 ** storing it at 'base'. 'limit' marks the highest address it can
@@ -517,6 +771,20 @@ static int32 read_textfile(FILE *textfile, byte *base, byte *limit, boolean sile
   boolean gzipped = FALSE;
 #ifdef HAVE_ZLIB_H
   gzFile gzipfile;
+#endif
+#ifdef TOKCACHE
+  tokcacheheader header;
+  char realname[PATH_MAX], cachename[PATH_MAX];
+  boolean cacheable;
+
+  cacheable = tokcache_header(textfile, &header, realname, cachename);
+  if (cacheable) {
+    length = read_tokcache(&header, realname, cachename, base, limit);
+    if (length > 0) {
+      fclose(textfile);
+      return length;
+    }
+  }
 #endif
   fseek (textfile, 0, 0);
   tokenline[2] = 0;
@@ -545,9 +813,12 @@ static int32 read_textfile(FILE *textfile, byte *base, byte *limit, boolean sile
     result = gzgets(gzipfile, basicvars.stringwork, INPUTLEN);
   else
 #endif
-  result = fgets(basicvars.stringwork, INPUTLEN, textfile);
+    result = fgets(basicvars.stringwork, INPUTLEN, textfile);
     if (result!=NIL && basicvars.stringwork[0]=='#') {	/* Ignore first line if it starts with a '#' */
     basicvars.runflags.quitatend=basicvars.runflags.loadngo;
+#ifdef TOKCACHE
+    header.flags |= TOKCACHE_HASHBANG;
+#endif
 #ifdef HAVE_ZLIB_H
     if (gzipped)
       result = gzgets(gzipfile, basicvars.stringwork, INPUTLEN);
@@ -605,6 +876,12 @@ static int32 read_textfile(FILE *textfile, byte *base, byte *limit, boolean sile
     if (!basicvars.runflags.loadngo) emulate_printf("Line numbers added to program\r\n");
     renumber_program(filebase, 1, 1);
   }
+#ifdef TOKCACHE
+  if (cacheable && !matrixflags.scrunge) {	/* Scrunged programs are not meant to be readable */
+    if (needsnumbers) header.flags |= TOKCACHE_RENUMBERED;
+    write_tokcache(&header, realname, cachename, filebase, ALIGN(base-filebase+ENDMARKSIZE));
+  }
+#endif
   return ALIGN(base-filebase+ENDMARKSIZE);
 }
 
@@ -848,6 +1125,17 @@ static void read_bbclib(FILE *libfile, char *name, boolean onheap, int32 ftype)
 static void read_textlib(FILE *libfile, char *name, boolean onheap) {
   int32 size;
   byte *base;
+#ifdef TOKCACHE
+  if (!onheap) {	/* Library being loaded via 'INSTALL' - Try to use cached copy in place */
+    base = map_tokcache(libfile, &size);
+    if (base != NIL) {
+      fclose(libfile);
+      if (basicvars.debug_flags.debug) fprintf(stderr, "Mapped library '%s' at %p, size = %d\n", name, base, size);
+      link_library(name, base, size, onheap);
+      return;
+    }
+  }
+#endif
   base = basicvars.vartop;
   size = read_textfile(libfile, base, basicvars.stacktop.bytesp, TRUE);
   if (onheap) {
@@ -133,6 +133,10 @@ static void handle_signal(int signo) {
     (void) signal(SIGSEGV, handle_signal);
 #endif
     error(ERR_ADDREXCEPT);
+#ifdef SIGBUS
+  case SIGBUS:		/* File mapped into memory was truncated by another program */
+    error(ERR_ADDREXCEPT);
+#endif
   case SIGABRT:
 #ifdef TARGET_MINGW
     (void) signal(SIGABRT, handle_signal);
@@ -239,6 +243,9 @@ void init_errors(void) {
     (void) sigaction(SIGPIPE, &sa, NULL);
     (void) sigaction(SIGFPE, &sa, NULL);
     (void) sigaction(SIGSEGV, &sa, NULL);
+#ifdef SIGBUS
+    (void) sigaction(SIGBUS, &sa, NULL);
+#endif
     (void) sigaction(SIGABRT, &sa, NULL);
     (void) sigaction(SIGINT, &sa, NULL);
 #if defined(TARGET_UNIX) | defined(TARGET_MACOSX)
@@ -258,6 +265,9 @@ void restore_handlers(void) {
   if (basicvars.misc_flags.trapexcp) {
     (void) signal(SIGFPE, SIG_DFL);
     (void) signal(SIGSEGV, SIG_DFL);
+#ifdef SIGBUS
+    (void) signal(SIGBUS, SIG_DFL);
+#endif
     (void) signal(SIGABRT, SIG_DFL);
     (void) signal(SIGINT, SIG_DFL);
 #if defined(TARGET_UNIX) | defined(TARGET_MACOSX)
@@ -355,6 +365,10 @@ void show_help(void) {
 #else
   printf("  -ignore        Ignore 'unsupported feature' where possible\n");
 #endif
+#ifdef TARGET_UNIX
+  printf("  -nocache       Do not use or save cached copies of tokenised programs\n");
+#endif
+  printf("  -profile       Show how long each stage of starting the interpreter takes\n");
   printf("  --             Subsequent options are passed to Basic program\n");
   printf("  <file>         Run Basic program <file> and leave interpreter when it ends\n\n");
 #ifdef HAVE_ZLIB_H
@@ -579,6 +593,7 @@ static detail errortable [] = {
 // Dynamic Linker errors
 /* ERR_DL_NODL */	{FATAL,    NOPARM,   0, "Dynamic Linking not available"},
 /* ERR_DL_NOSYM */	{FATAL,    STRING,   0, "%s"},
+/* ERR_DL_BADSIG */	{NONFATAL, NOPARM,   0, "Bad function signature or handle"},
 //
 /* ERR_BAD_OSFILE */	{NONFATAL, NOPARM,1026, "Bad OSFile call"},
 /* ERR_FILELOCKED */	{NONFATAL, NOPARM, 195, "This item is locked to stop changes being made to it"},
@@ -834,6 +849,14 @@ char *get_lasterror(void) {
   }
 }
 
+/*
+** 'get_equiverror' returns the error number the program sees for
+** interpreter error 'errnumber'
+*/
+int32 get_equiverror(int32 errnumber) {
+  return errortable[errnumber].equiverror;
+}
+
 /*
 ** 'show_error' is called to report a user-specified error, that is, it
 ** deals with the error raised via an 'ERROR' statement
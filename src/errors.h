@@ -192,6 +192,7 @@ typedef enum {
 // Dynamic Linker errors
     ERR_DL_NODL,	/* 0, dlopen() and friends not available */
     ERR_DL_NOSYM,	/* 0, Symbol not found */
+    ERR_DL_BADSIG,	/* 0, Bad function signature */
 // Misc errors
     ERR_BAD_OSFILE,	/* 1026, Bad OSFile call */
     ERR_FILELOCKED,	/* 67779, This item is locked */
@@ -214,6 +215,7 @@ extern void restore_handlers(void);
 extern void cmderror(int32, ...);
 extern void error(int32, ...);
 extern char *get_lasterror(void);
+extern int32 get_equiverror(int32);
 extern void show_error(int32, char *);
 extern void set_error(void);
 extern void set_local_error(void);
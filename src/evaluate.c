@@ -273,6 +273,63 @@ boolean check_arrays(basicarray *p1, basicarray *p2) {
   return n == p1->dimcount;
 }
 
+/*
+** Array slices, for example 'a(2,)' or 'a(10 TO 19)', are described by
+** descriptors that point into the storage of the original array so that
+** the elements do not have to be copied. A slice's descriptor has to
+** last as long as the reference to it on the Basic stack and no longer.
+** They are kept in a list, most recently created first, along with the
+** address of that stack entry. Once the Basic stack has been cut back
+** past the entry, the descriptor is no longer in use and can be reused.
+** Slices passed to procedures and functions have their descriptors
+** copied on to the Basic stack (see 'push_oneparm')
+*/
+typedef struct arrayview {
+  basicarray descriptor;		/* Descriptor for the slice */
+  byte *stackentry;			/* Address of the reference to it on the Basic stack */
+  struct arrayview *nextview;
+} arrayview;
+
+static arrayview *liveviews;		/* Slices that might still be in use */
+static arrayview *freeviews;		/* Slice descriptors available for reuse */
+
+/*
+** 'new_arrayview' returns a pointer to an unused slice descriptor,
+** first reclaiming any that are no longer referenced from the stack
+*/
+static arrayview *new_arrayview(void) {
+  arrayview *vp;
+  while (liveviews != NIL && liveviews->stackentry < basicvars.stacktop.bytesp) {
+    vp = liveviews;
+    liveviews = vp->nextview;
+    vp->nextview = freeviews;
+    freeviews = vp;
+  }
+  if (freeviews != NIL) {
+    vp = freeviews;
+    freeviews = vp->nextview;
+  }
+  else {
+    vp = malloc(sizeof(arrayview));
+    if (vp == NIL) error(ERR_NOROOM);
+  }
+  vp->nextview = liveviews;
+  liveviews = vp;
+  return vp;
+}
+
+/*
+** 'is_arrayview' returns TRUE if the array descriptor 'ap' is that of
+** a slice of an array
+*/
+static boolean is_arrayview(basicarray *ap) {
+  arrayview *vp;
+  for (vp = liveviews; vp != NIL; vp = vp->nextview) {
+    if (&vp->descriptor == ap) return TRUE;
+  }
+  return FALSE;
+}
+
 /*
 ** 'type_table' is used for checking the types of formal and
 ** actual procedure and function parameters. The first index gives
@@ -392,7 +449,7 @@ static void push_oneparm(formparm *fp, int32 parmno, char *procname) {
   int64 int64parm = 0;
   float64 floatparm = 0;
   basicstring stringparm = {0, NULL};
-  basicarray *arrayparm = NULL;
+  basicarray *arrayparm = NULL, viewparm;
   lvalue retparm;
   stackitem parmtype = STACK_UNKNOWN;
   boolean isreturn;
@@ -410,8 +467,13 @@ static void push_oneparm(formparm *fp, int32 parmno, char *procname) {
     else if (parmtype == STACK_FLOAT) floatparm = pop_float();
     else if (parmtype == STACK_STRING || parmtype == STACK_STRTEMP)
       stringparm = pop_string();
-    else if (parmtype >= STACK_INTARRAY && parmtype <= STACK_SATEMP)
+    else if (parmtype >= STACK_INTARRAY && parmtype <= STACK_SATEMP) {
       arrayparm = pop_array();
+      if (is_arrayview(arrayparm)) {	/* Slice of an array - Take a copy of its descriptor */
+        viewparm = *arrayparm;
+        arrayparm = &viewparm;
+      }
+    }
     else {
       error(ERR_BROKEN, __LINE__, "evaluate");
     }
@@ -650,7 +712,17 @@ static void push_oneparm(formparm *fp, int32 parmno, char *procname) {
     if (parmtype == STACK_STRTEMP) free_string(stringparm);
     break;
   }
-  case VAR_INTARRAY: case VAR_UINT8ARRAY: case VAR_FLOATARRAY: case VAR_STRARRAY:
+  case VAR_INTARRAY: case VAR_UINT8ARRAY: case VAR_INT64ARRAY: case VAR_FLOATARRAY: case VAR_STRARRAY:
+/*
+** The descriptor of a slice is put on the stack immediately before the
+** saved value of the formal parameter so that 'restore' in stack.c can
+** discard it when the procedure or function returns
+*/
+    if (arrayparm == &viewparm) {
+      arrayparm = alloc_stackmem(sizeof(basicarray));
+      if (arrayparm == NIL) error(ERR_STACKFULL);
+      *arrayparm = viewparm;
+    }
     save_array(fp->parameter);
     *fp->parameter.address.arrayaddr = arrayparm;
     break;
@@ -872,6 +944,74 @@ static void do_arrayvar(void) {
 }
 
 
+/*
+** 'do_arrayview' is called by 'do_arrayref' when the reference turns
+** out to be to a slice of the array rather than to a single element.
+** There are two forms. In 'a(i,)' the leading indexes are given and
+** the remaining dimensions are taken in full, so that if 'a' has two
+** dimensions this is row 'i' of the array. In 'a(i TO j)' or 'a(i TO
+** j,)' the last index given is a range. Either way the elements
+** selected are contiguous and the slice is described by a descriptor
+** that points into the original array. 'dimno' is the dimension the
+** last index refers to, 'first' the element that the indexes up to
+** and including it select when the array is treated as having only
+** 'dimno'+1 dimensions and 'low' the value of that index. On entry
+** 'current' points at either the 'TO' or the trailing comma
+*/
+static void do_arrayview(variable *vp, int32 dimno, int32 first, int32 low) {
+  basicarray *original, *view;
+  arrayview *newview;
+  int32 n, count, high, inner;
+  boolean isrange;
+  original = vp->varentry.vararray;
+  count = 1;
+  isrange = *basicvars.current == BASIC_TOKEN_TO;
+  if (isrange) {
+    basicvars.current++;
+    expression();
+    high = pop_anynum32();
+    if (high < low || high >= original->dimsize[dimno]) error(ERR_BADINDEX, high, vp->varname);
+    count = high-low+1;
+    if (*basicvars.current == ',') {
+      basicvars.current++;
+      if (*basicvars.current != ')') error(ERR_RPMISS);
+    }
+    else if (dimno != original->dimcount-1) error(ERR_INDEXCO, vp->varname);	/* Not enough dimensions */
+  }
+  else {	/* Skip trailing comma */
+    basicvars.current++;
+    if (dimno == original->dimcount-1) error(ERR_INDEXCO, vp->varname);	/* Too many dimensions */
+  }
+  if (*basicvars.current != ')') error(ERR_RPMISS);
+  basicvars.current++;
+  newview = new_arrayview();
+  view = &newview->descriptor;
+  *view = *original;
+  view->dimcount = 0;
+  if (isrange) {	/* Slice keeps the dimension the range was given for */
+    view->dimsize[0] = count;
+    view->dimcount = 1;
+  }
+  inner = 1;
+  for (n = dimno+1; n < original->dimcount; n++) {
+    view->dimsize[view->dimcount] = original->dimsize[n];
+    view->dimcount++;
+    inner = inner*original->dimsize[n];
+  }
+  view->arrsize = count*inner;
+  view->offheap = FALSE;
+  switch (vp->varflags) {
+  case VAR_INTARRAY:   view->arraystart.intbase = original->arraystart.intbase+(size_t)first*inner; break;
+  case VAR_UINT8ARRAY: view->arraystart.uint8base = original->arraystart.uint8base+(size_t)first*inner; break;
+  case VAR_INT64ARRAY: view->arraystart.int64base = original->arraystart.int64base+(size_t)first*inner; break;
+  case VAR_FLOATARRAY: view->arraystart.floatbase = original->arraystart.floatbase+(size_t)first*inner; break;
+  case VAR_STRARRAY:   view->arraystart.stringbase = original->arraystart.stringbase+(size_t)first*inner; break;
+  default: error(ERR_BROKEN, __LINE__, "evaluate");
+  }
+  push_array(view, vp->varflags);
+  newview->stackentry = basicvars.stacktop.bytesp;
+}
+
 /*
 ** 'do_arrayref' handles array references where an individual element is
 ** being accessed. It deals with both simple references to them and
@@ -895,6 +1035,10 @@ static void do_arrayref(void) {
     expression();	      /* Evaluate an array index */
     element = pop_anynum32();
     if (element < 0 || element >= descriptor->dimsize[0]) error(ERR_BADINDEX, element, vp->varname);
+    if (*basicvars.current == BASIC_TOKEN_TO) {	/* Got 'a(i TO j)' */
+      do_arrayview(vp, 0, element, element);
+      return;
+    }
   }
   else {	/* Multi-dimensional array */
     maxdims = descriptor->dimcount;
@@ -904,6 +1048,10 @@ static void do_arrayref(void) {
       expression();	      /* Evaluate an array index */
       index = pop_anynum32();
       if (index < 0 || index >= descriptor->dimsize[dimcount]) error(ERR_BADINDEX, index, vp->varname);
+      if (*basicvars.current == BASIC_TOKEN_TO || (*basicvars.current == ',' && *(basicvars.current+1) == ')')) {
+        do_arrayview(vp, dimcount, element+index, index);	/* Reference is to a slice of the array */
+        return;
+      }
       dimcount++;
       element+=index;
       if (*basicvars.current != ',') break;	/* No more array indexes expected */
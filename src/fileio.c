@@ -27,19 +27,31 @@
 ** provided by the underlying operating system.
 */
 
+/* Use 64-bit file offsets so that PTR# and EXT# work on files over 2GB */
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <sys/types.h>
 #include "common.h"
 #include "miscprocs.h"
 #include "target.h"
+#ifdef TARGET_UNIX
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
 #include "errors.h"
 #include "fileio.h"
 #include "strings.h"
 #include "screen.h"
-#ifndef NONET
 #include "net.h"
-#endif
 #include "keyboard.h"
 
 
@@ -48,6 +60,16 @@ enum {XMIXED_ENDIAN, XLITTLE_ENDIAN, XBIG_ENDIAN, XBIG_MIXED_ENDIAN} double_type
 
 typedef enum {CLOSED, OPENIN, OPENUP, OPENOUT, NETWORK} filestate;
 
+#ifdef TARGET_DJGPP
+typedef long int fileoffset;	/* DJGPP lacks 'fseeko' and 'ftello' */
+#define FSEEK fseek
+#define FTELL ftell
+#else
+typedef off_t fileoffset;
+#define FSEEK fseeko
+#define FTELL ftello
+#endif
+
 typedef enum {OKAY, PENDING, ATEOF} eofstate;
 
 typedef struct {
@@ -55,18 +77,35 @@ typedef struct {
   filestate filetype;		/* Way in which file has been opened */
   eofstate eofstatus;		/* Current end-of-file status */
   boolean lastwaswrite;		/* TRUE if the last operation on a file was a write */
+  boolean sequential;		/* TRUE if file has only been read sequentially so far */
+  boolean regular;		/* TRUE if file opened with OPENIN is an ordinary file */
   int nethandle;		/* network handle */
+  byte *mapbase;		/* Address of file contents if mapped into memory by OPENIN */
+  fileoffset mapsize;		/* Size of mapped file */
+  fileoffset mappos;		/* Current file pointer in mapped file */
 } fileblock;
 
 #ifdef TARGET_RISCOS
 #define MAXFILES 4		/* Maximum number of files that can be open simultaneously - only tracks networking on RISC OS */
 #define FIRSTHANDLE 4		/* Number of first handle */
 #else
-#define MAXFILES 25		/* Maximum number of files that can be open simultaneously */
+#define MAXFILES 25		/* Maximum number of files that can be open simultaneously if there is no other limit */
+#define MAXFILELIMIT 65536	/* Upper bound on number of open files whatever the operating system allows */
 #define FIRSTHANDLE 254		/* Number of first handle */
+#define SLOTBITS 64		/* Number of file slots covered by each word of 'slotmap' */
 #endif
 
+#define READAHEAD_SIZE 65536	/* Size of stdio buffer used for files opened for input */
+
+#ifdef TARGET_RISCOS
 static fileblock fileinfo [MAXFILES+1];
+#else
+static fileblock *fileinfo;	/* Table of open files, grown as needed */
+static uint64 *slotmap;		/* Bit set for each entry of 'fileinfo' in use */
+static int32 filecount;		/* Number of entries in 'fileinfo' */
+static int32 filelimit;		/* Most files that can be open at once */
+static int32 firstslots;	/* Index of first word in 'slotmap' that might have a free entry */
+#endif
 
 #ifdef TARGET_RISCOS
 
@@ -486,7 +525,7 @@ void fileio_printstring(int32 handle, char *string, int32 length) {
 ** 'fileio_getptr' returns the current value of the file pointer for
 ** the file 'handle'
 */
-int32 fileio_getptr(int32 handle) {
+int64 fileio_getptr(int32 handle) {
   int32 pointer;
   if (handle == 0) return 0;
   pointer = _kernel_osargs(0, handle, 0);	/* OS_Args 0 = read file pointer */
@@ -498,7 +537,7 @@ int32 fileio_getptr(int32 handle) {
 ** 'fileio_setptr' is used to set the current file pointer of
 ** the file 'handle'
 */
-void fileio_setptr(int32 handle, int32 newoffset) {
+void fileio_setptr(int32 handle, int64 newoffset) {
   int32 result;
   result = _kernel_osargs(1, handle, newoffset);	/* OS_Args 1 = set file pointer */
   if (result==_kernel_ERROR) report();
@@ -507,7 +546,7 @@ void fileio_setptr(int32 handle, int32 newoffset) {
 /*
 ** 'fileio_getext' returns the size of the file with handle 'handle'
 */
-int32 fileio_getext(int32 handle) {
+int64 fileio_getext(int32 handle) {
   int32 extent;
   extent = _kernel_osargs(2, handle, 0);	/* OS_Args 2 = read file's extent (size) */
   if (extent==_kernel_ERROR) report();
@@ -518,7 +557,7 @@ int32 fileio_getext(int32 handle) {
 ** 'fileio_setext' is called to alter the extent (size) of the file
 ** with handle 'handle'
 */
-void fileio_setext(int32 handle, int32 newsize) {
+void fileio_setext(int32 handle, int64 newsize) {
   int32 result;
   result = _kernel_osargs(3, handle, newsize);	/* OS_Args 3 = alter file's extent (size) */
   if (result==_kernel_ERROR) report();
@@ -535,6 +574,53 @@ int32 fileio_eof(int32 handle) {
   return result==0 ? FALSE : TRUE;
 }
 
+/*
+** 'fileio_accept', 'fileio_netcontrol', 'fileio_netflush', 'fileio_netstatus',
+** 'fileio_sendbatch', 'fileio_recvbatch', 'fileio_sendfile',
+** 'fileio_recvfile' and 'fileio_wait' are not supported under RISC OS
+*/
+int32 fileio_accept(int32 handle) {
+  error(ERR_NET_NOTSUPP);
+  return 0;
+}
+
+void fileio_netcontrol(int32 handle, int32 reason, int32 value) {
+  error(ERR_NET_NOTSUPP);
+}
+
+void fileio_netflush(void) {
+}
+
+int32 fileio_netstatus(int32 handle, int32 *errnum) {
+  error(ERR_NET_NOTSUPP);
+  return 0;
+}
+
+int32 fileio_sendbatch(int32 handle, char *data, int32 *lengths, int32 count) {
+  error(ERR_NET_NOTSUPP);
+  return 0;
+}
+
+int32 fileio_recvbatch(int32 handle, char *buffer, int32 slotsize, int32 *lengths, int32 count) {
+  error(ERR_NET_NOTSUPP);
+  return 0;
+}
+
+int32 fileio_sendfile(int32 handle, int32 file, int64 offset, int64 count, int64 *done) {
+  error(ERR_NET_NOTSUPP);
+  return 0;
+}
+
+int32 fileio_recvfile(int32 handle, int32 file, int64 count, int64 *done) {
+  error(ERR_NET_NOTSUPP);
+  return 0;
+}
+
+int32 fileio_wait(int32 *handles, int32 *events, int32 count, int32 timeout) {
+  error(ERR_UNSUPPORTED);
+  return 0;
+}
+
 /*
 ** 'fileio_shutdown' is called at the end of the run of the
 ** interpreter. This is not required under RISC OS
@@ -589,14 +675,176 @@ boolean isapath(char *name) {
 
 /*
 ** 'map_handle' maps a Basic-style file handle to the corresponding entry
-** in the 'fileinfo' table and checks that the handle is valid
+** in the 'fileinfo' table and checks that the handle is valid.
+** Handles count down from FIRSTHANDLE as they always have. If more
+** than FIRSTHANDLE files are open at once, the rest count up from
+** FIRSTHANDLE+1
 */
 static int32 map_handle(int32 handle) {
-  handle = FIRSTHANDLE-handle;
-  if (handle<0 || handle>=MAXFILES || fileinfo[handle].filetype==CLOSED) error(ERR_BADHANDLE);
+  if (handle<=0) error(ERR_BADHANDLE);
+  handle = handle<=FIRSTHANDLE ? FIRSTHANDLE-handle : handle-1;
+  if (handle>=filecount || fileinfo[handle].filetype==CLOSED) error(ERR_BADHANDLE);
   return handle;
 }
 
+/*
+** 'find_handle' returns the index of the first unused entry in the
+** 'fileinfo' table, growing the table if it is full. A bitmap of the
+** entries in use is kept so that a free entry can be found without
+** looking at every open file. The entry is only marked as in use by
+** 'claim_handle' once the file has been opened successfully
+*/
+static int32 find_handle(void) {
+  int32 w, n, oldcount, newcount;
+  uint64 freebits, *newmap;
+  fileblock *newinfo;
+  for (w=firstslots; w<filecount/SLOTBITS; w++) {
+    if (slotmap[w]!=~(uint64)0) break;
+  }
+  firstslots = w;
+  if (w==filecount/SLOTBITS) {	/* Table is full - Make it bigger */
+    if (filecount>=filelimit) error(ERR_MAXHANDLE);
+    oldcount = filecount;
+    newcount = oldcount==0 ? SLOTBITS : oldcount*2;
+    newinfo = realloc(fileinfo, newcount*sizeof(fileblock));
+    if (newinfo==NIL) error(ERR_NOROOM);	/* Old table is still intact */
+    fileinfo = newinfo;
+    newmap = realloc(slotmap, newcount/SLOTBITS*sizeof(uint64));
+    if (newmap==NIL) error(ERR_NOROOM);		/* Only the first 'filecount' entries of 'fileinfo' are used */
+    slotmap = newmap;
+    memset(fileinfo+oldcount, 0, (newcount-oldcount)*sizeof(fileblock));
+    memset(slotmap+oldcount/SLOTBITS, 0, (newcount-oldcount)/SLOTBITS*sizeof(uint64));
+    filecount = newcount;
+  }
+  freebits = ~slotmap[w];
+  for (n=0; (freebits & 1)==0; n++) freebits = freebits>>1;
+  n+=w*SLOTBITS;
+  if (n>=filelimit) error(ERR_MAXHANDLE);
+  return n;
+}
+
+/*
+** 'claim_handle' marks entry 'n' of the 'fileinfo' table as in use
+** and returns the Basic handle for it
+*/
+static int32 claim_handle(int32 n) {
+  slotmap[n/SLOTBITS] |= (uint64)1<<(n%SLOTBITS);
+  return n<FIRSTHANDLE ? FIRSTHANDLE-n : n+1;
+}
+
+/*
+** 'release_handle' marks entry 'n' of the 'fileinfo' table as free
+*/
+static void release_handle(int32 n) {
+  slotmap[n/SLOTBITS] &= ~((uint64)1<<(n%SLOTBITS));
+  if (n/SLOTBITS<firstslots) firstslots = n/SLOTBITS;
+}
+
+/*
+** 'start_readahead' is called when a file is opened for input. Files
+** opened with OPENIN are nearly always read from start to end, so the
+** file gets a larger stdio buffer and, where the operating system
+** supports it, the kernel is told to expect sequential reads. It then
+** reads ahead of the program more aggressively, so that most BGET#,
+** GET$# and INPUT# calls are satisfied from memory without waiting
+** for the disk. 'stop_readahead' undoes the hint when the program
+** starts to move around the file with PTR#
+*/
+static void start_readahead(int32 n) {
+#if defined(TARGET_UNIX) && defined(MADV_SEQUENTIAL)
+  if (fileinfo[n].mapbase!=NIL)
+    madvise(fileinfo[n].mapbase, fileinfo[n].mapsize, MADV_SEQUENTIAL);
+  else
+#endif
+  setvbuf(fileinfo[n].stream, NIL, _IOFBF, READAHEAD_SIZE);
+#if defined(TARGET_UNIX) && defined(POSIX_FADV_SEQUENTIAL)
+  posix_fadvise(fileno(fileinfo[n].stream), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  fileinfo[n].sequential = TRUE;
+}
+
+static void stop_readahead(int32 n) {
+#if defined(TARGET_UNIX) && defined(MADV_NORMAL)
+  if (fileinfo[n].mapbase!=NIL) madvise(fileinfo[n].mapbase, fileinfo[n].mapsize, MADV_NORMAL);
+#endif
+#if defined(TARGET_UNIX) && defined(POSIX_FADV_NORMAL)
+  posix_fadvise(fileno(fileinfo[n].stream), 0, 0, POSIX_FADV_NORMAL);
+#endif
+  fileinfo[n].sequential = FALSE;
+}
+
+/*
+** 'map_file' maps the whole of a file just opened with OPENIN into
+** memory if it is an ordinary file. BGET#, GET$#, INPUT#, PTR#, EXT#
+** and EOF# are then dealt with directly from the mapping instead of
+** going through the C library. If the file cannot be mapped it is
+** read in the normal way. This is turned on with the SYS call
+** 'Brandy_MapInput'
+*/
+static void map_file(int32 n) {
+  fileinfo[n].mapbase = NIL;
+#ifdef TARGET_UNIX
+  struct stat filestat;
+  void *base;
+
+  if (!matrixflags.mapinput) return;
+  if (fstat(fileno(fileinfo[n].stream), &filestat)==-1 || !S_ISREG(filestat.st_mode)) return;
+  if (filestat.st_size==0 || filestat.st_size!=(size_t)filestat.st_size) return;
+  base = mmap(NIL, filestat.st_size, PROT_READ, MAP_SHARED, fileno(fileinfo[n].stream), 0);
+  if (base==MAP_FAILED) return;
+  fileinfo[n].mapbase = base;
+  fileinfo[n].mapsize = filestat.st_size;
+  fileinfo[n].mappos = 0;
+#endif
+}
+
+/*
+** 'check_mapping' returns TRUE if file 'n' is mapped into memory and
+** can still be read from there. If another program has changed the
+** size of the file since it was mapped, the mapping is dropped and the
+** file is read through the C library from then on, so that a file
+** that has been extended shows its new size. This is only done when
+** the end of the mapping is reached and for EXT#, so that reading
+** a mapped file costs nothing extra
+*/
+static boolean check_mapping(int32 n) {
+#ifdef TARGET_UNIX
+  struct stat filestat;
+
+  if (fileinfo[n].mapbase==NIL) return FALSE;
+  if (fstat(fileno(fileinfo[n].stream), &filestat)==0 && filestat.st_size==fileinfo[n].mapsize) return TRUE;
+  munmap(fileinfo[n].mapbase, fileinfo[n].mapsize);
+  fileinfo[n].mapbase = NIL;
+  FSEEK(fileinfo[n].stream, fileinfo[n].mappos, SEEK_SET);
+#endif
+  return FALSE;
+}
+
+/*
+** 'use_mapping' returns TRUE if 'count' bytes can be read from file 'n'
+** through its mapping. The size of the file is checked only if there
+** are fewer than 'count' bytes left in the mapping
+*/
+static boolean use_mapping(int32 n, fileoffset count) {
+  if (fileinfo[n].mapbase==NIL) return FALSE;
+  return fileinfo[n].mapsize-fileinfo[n].mappos>=count || check_mapping(n);
+}
+
+/*
+** 'is_regular' returns TRUE if file 'n' is an ordinary file rather
+** than a pipe, terminal or device. It is taken to be one of those
+** where this cannot be found out
+*/
+static boolean is_regular(int32 n) {
+#ifdef TARGET_UNIX
+  struct stat filestat;
+
+  return fstat(fileno(fileinfo[n].stream), &filestat)==0 && S_ISREG(filestat.st_mode);
+#else
+  return FALSE;
+#endif
+}
+
 /*
 ** 'fileio_openin' opens a file for input
 */
@@ -605,8 +853,7 @@ int32 fileio_openin(char *name, int32 namelen) {
   int32 n;
   char filename [FNAMESIZE];
   if ((namelen < 0) || (namelen > (FNAMESIZE - 1))) error(ERR_INVALIDFNAME);
-  for (n=0; n<MAXFILES && fileinfo[n].stream!=NIL; n++);	/* Find an unused handle */
-  if (n>=MAXFILES) error(ERR_MAXHANDLE);
+  n = find_handle();
   memmove(filename, name, namelen);
   filename[namelen] = asc_NUL;
   thefile = fopen(filename, INMODE);
@@ -623,7 +870,10 @@ int32 fileio_openin(char *name, int32 namelen) {
   fileinfo[n].filetype = OPENIN;
   fileinfo[n].eofstatus = OKAY;
   fileinfo[n].lastwaswrite = FALSE;
-  return FIRSTHANDLE-n;
+  fileinfo[n].regular = is_regular(n);
+  map_file(n);
+  start_readahead(n);
+  return claim_handle(n);
 }
 
 /*
@@ -638,8 +888,7 @@ int32 fileio_openout(char *name, int32 namelen) {
   int32 n;
   char filename [FNAMESIZE];
   if ((namelen < 0) || (namelen > (FNAMESIZE - 1))) error(ERR_INVALIDFNAME);
-  for (n=0; n<MAXFILES && fileinfo[n].stream!=NIL; n++);	/* Find an unused handle */
-  if (n>=MAXFILES) error(ERR_MAXHANDLE);
+  n = find_handle();
   memmove(filename, name, namelen);
   filename[namelen] = asc_NUL;
   thefile = fopen(filename, OUTMODE);
@@ -648,9 +897,206 @@ int32 fileio_openout(char *name, int32 namelen) {
   fileinfo[n].filetype = OPENOUT;
   fileinfo[n].eofstatus = OKAY;
   fileinfo[n].lastwaswrite = FALSE;
-  return FIRSTHANDLE-n;
+  fileinfo[n].sequential = FALSE;
+  return claim_handle(n);
+}
+
+#ifndef NONET
+/*
+** 'open_network' fills in entry 'n' of the 'fileinfo' table for
+** the network connection with index 'nethandle' in the network code's
+** socket table and returns the Basic handle for it
+*/
+static int32 open_network(int32 n, int nethandle) {
+  fileinfo[n].stream = (void *)42; /* Not used, but != NIL */
+  fileinfo[n].filetype = NETWORK;
+  fileinfo[n].eofstatus = OKAY;
+  fileinfo[n].lastwaswrite = FALSE;
+  fileinfo[n].sequential = FALSE;
+  fileinfo[n].mapbase = NIL;
+  fileinfo[n].nethandle = nethandle;
+  return claim_handle(n);
+}
+
+/*
+** 'fileio_accept' takes the next incoming connection on the listening
+** socket with handle 'handle' and returns the handle for it. It
+** returns zero if there is no connection waiting
+*/
+int32 fileio_accept(int32 handle) {
+  int32 n;
+  int nethandle;
+
+  if (handle==0) error(ERR_BADHANDLE);
+  handle = map_handle(handle);
+  if (fileinfo[handle].filetype!=NETWORK) error(ERR_NET_NOTSUPP);
+  n = find_handle();
+  nethandle = brandynet_accept(fileinfo[handle].nethandle);
+  if (nethandle == -1) return 0;
+  return open_network(n, nethandle);
+}
+
+/*
+** 'fileio_netcontrol' carries out operation 'reason' (one of the
+** NETCTL_xxx values) on the network connection with handle 'handle'
+*/
+void fileio_netcontrol(int32 handle, int32 reason, int32 value) {
+  if (handle==0) error(ERR_BADHANDLE);
+  handle = map_handle(handle);
+  if (fileinfo[handle].filetype!=NETWORK) error(ERR_NET_NOTSUPP);
+  if (net_control(fileinfo[handle].nethandle, reason, value)) error(ERR_CANTWRITE);
+}
+
+/*
+** 'fileio_netflush' sends any output waiting to go out on network
+** connections. It is called before the interpreter waits for a key,
+** a line of input or a period of time to pass
+*/
+void fileio_netflush(void) {
+  net_flushall();
+}
+
+/*
+** 'fileio_netstatus' returns how far the network connection with
+** handle 'handle' has got if it was opened without waiting for it to
+** be made. See 'net_status'
+*/
+int32 fileio_netstatus(int32 handle, int32 *errnum) {
+  if (handle==0) error(ERR_BADHANDLE);
+  handle = map_handle(handle);
+  if (fileinfo[handle].filetype!=NETWORK) error(ERR_NET_NOTSUPP);
+#ifdef TARGET_UNIX
+  return net_status(fileinfo[handle].nethandle, errnum);
+#else
+  *errnum = 0;
+  return 0;
+#endif
+}
+
+/*
+** 'fileio_sendbatch' sends 'count' datagrams on the UDP socket with
+** handle 'handle'. See 'net_sendbatch'
+*/
+int32 fileio_sendbatch(int32 handle, char *data, int32 *lengths, int32 count) {
+  if (handle==0) error(ERR_BADHANDLE);
+  handle = map_handle(handle);
+  if (fileinfo[handle].filetype!=NETWORK) error(ERR_NET_NOTSUPP);
+  if (count<=0) return 0;
+  return net_sendbatch(fileinfo[handle].nethandle, data, lengths, count);
 }
 
+/*
+** 'fileio_recvbatch' reads up to 'count' datagrams from the UDP socket
+** with handle 'handle'. See 'net_recvbatch'
+*/
+int32 fileio_recvbatch(int32 handle, char *buffer, int32 slotsize, int32 *lengths, int32 count) {
+  if (handle==0) error(ERR_BADHANDLE);
+  handle = map_handle(handle);
+  if (fileinfo[handle].filetype!=NETWORK) error(ERR_NET_NOTSUPP);
+  if (count<=0) return 0;
+  return net_recvbatch(fileinfo[handle].nethandle, buffer, slotsize, lengths, count);
+}
+
+/*
+** 'fileio_sendfile' sends up to 'count' bytes of the file with handle
+** 'file' on the network connection with handle 'handle', starting at
+** offset 'offset' in the file. If 'offset' is -1 the transfer starts at
+** the file's current pointer and the pointer is moved on past what was
+** sent. If 'count' is -1 the rest of the file is sent. The number of
+** bytes sent is stored at 'done' and one of the NETXFER_xxx values is
+** returned. See 'net_sendfile'
+*/
+int32 fileio_sendfile(int32 handle, int32 file, int64 offset, int64 count, int64 *done) {
+  int64 start;
+  int32 n, result;
+
+  if (handle==0 || file==0) error(ERR_BADHANDLE);
+  if (offset<-1 || count<-1) error(ERR_RANGE);
+  start = offset==-1 ? fileio_getptr(file) : offset;
+  handle = map_handle(handle);
+  if (fileinfo[handle].filetype!=NETWORK) error(ERR_NET_NOTSUPP);
+  n = map_handle(file);
+  if (fileinfo[n].filetype==NETWORK) error(ERR_NET_NOTSUPP);
+  if (fileinfo[n].lastwaswrite) {	/* Ensure everything has been written to disk first */
+    fflush(fileinfo[n].stream);
+    fileinfo[n].lastwaswrite = FALSE;
+  }
+  result = net_sendfile(fileinfo[handle].nethandle, fileno(fileinfo[n].stream), start, count, done);
+  if (offset==-1) fileio_setptr(file, start+*done);
+  return result;
+}
+
+/*
+** 'fileio_recvfile' writes up to 'count' bytes received on the network
+** connection with handle 'handle' to the file with handle 'file',
+** starting at the file's current pointer. It waits for the data to
+** arrive. If 'count' is -1 it carries on until the connection is
+** closed. The file pointer is moved on past what was written, the
+** number of bytes is stored at 'done' and one of the NETXFER_xxx values
+** is returned. See 'net_recvfile'
+*/
+int32 fileio_recvfile(int32 handle, int32 file, int64 count, int64 *done) {
+#ifdef TARGET_UNIX
+  int64 start;
+  int32 n, result;
+
+  if (handle==0 || file==0) error(ERR_BADHANDLE);
+  if (count<-1) error(ERR_RANGE);
+  start = fileio_getptr(file);
+  handle = map_handle(handle);
+  if (fileinfo[handle].filetype!=NETWORK) error(ERR_NET_NOTSUPP);
+  n = map_handle(file);
+  if (fileinfo[n].filetype==NETWORK) error(ERR_NET_NOTSUPP);
+  if (fileinfo[n].filetype==OPENIN) error(ERR_OPENIN);
+  fflush(fileinfo[n].stream);
+  fileinfo[n].lastwaswrite = FALSE;
+  result = net_recvfile(fileinfo[handle].nethandle, fileno(fileinfo[n].stream), start, count, done);
+  fileio_setptr(file, start+*done);
+  return result;
+#else
+  error(ERR_UNSUPPORTED);
+  return 0;
+#endif
+}
+#else
+int32 fileio_accept(int32 handle) {
+  error(ERR_NET_NOTSUPP);
+  return 0;
+}
+
+void fileio_netcontrol(int32 handle, int32 reason, int32 value) {
+  error(ERR_NET_NOTSUPP);
+}
+
+void fileio_netflush(void) {
+}
+
+int32 fileio_netstatus(int32 handle, int32 *errnum) {
+  error(ERR_NET_NOTSUPP);
+  return 0;
+}
+
+int32 fileio_sendbatch(int32 handle, char *data, int32 *lengths, int32 count) {
+  error(ERR_NET_NOTSUPP);
+  return 0;
+}
+
+int32 fileio_recvbatch(int32 handle, char *buffer, int32 slotsize, int32 *lengths, int32 count) {
+  error(ERR_NET_NOTSUPP);
+  return 0;
+}
+
+int32 fileio_sendfile(int32 handle, int32 file, int64 offset, int64 count, int64 *done) {
+  error(ERR_NET_NOTSUPP);
+  return 0;
+}
+
+int32 fileio_recvfile(int32 handle, int32 file, int64 count, int64 *done) {
+  error(ERR_NET_NOTSUPP);
+  return 0;
+}
+#endif
+
 /*
 ** 'fileio_openup' opens a file for update. The file must exist
 ** already. The file can both be read from and written to
@@ -661,8 +1107,7 @@ int32 fileio_openup(char *name, int32 namelen) {
   char filename [FNAMESIZE];
 
   if ((namelen < 0) || (namelen > (FNAMESIZE - 1))) error(ERR_INVALIDFNAME);
-  for (n=0; n<MAXFILES && fileinfo[n].stream!=NIL; n++);	/* Find an unused handle */
-  if (n>=MAXFILES) error(ERR_MAXHANDLE);
+  n = find_handle();
   memmove(filename, name, namelen);
   filename[namelen] = asc_NUL;
 #ifndef NONET
@@ -671,12 +1116,17 @@ int32 fileio_openup(char *name, int32 namelen) {
     int handle;
     handle=brandynet_connect(filename+4, filename[2]);
     if (handle == -1) return 0;
-    fileinfo[n].stream = (void *)42; /* Not used, but != NIL */
-    fileinfo[n].filetype = NETWORK;
-    fileinfo[n].eofstatus = OKAY;
-    fileinfo[n].lastwaswrite = FALSE;
-    fileinfo[n].nethandle = handle;
-    return FIRSTHANDLE-n;
+    return open_network(n, handle);
+  } else if (!strncmp(filename, "listen0:", 8) || !strncmp(filename, "listen4:", 8) || !strncmp(filename, "listen6:", 8)) {
+    int handle;
+    handle=brandynet_listen(filename+8, filename[6]);
+    if (handle == -1) return 0;
+    return open_network(n, handle);
+  } else if (!strncmp(filename, "udp0:", 5) || !strncmp(filename, "udp4:", 5) || !strncmp(filename, "udp6:", 5)) {
+    int handle;
+    handle=brandynet_udp(filename+5, filename[3]);
+    if (handle == -1) return 0;
+    return open_network(n, handle);
   } else {
 #endif
     thefile = fopen(filename, UPMODE);
@@ -693,7 +1143,8 @@ int32 fileio_openup(char *name, int32 namelen) {
     fileinfo[n].filetype = OPENUP;
     fileinfo[n].eofstatus = OKAY;
     fileinfo[n].lastwaswrite = FALSE;
-    return FIRSTHANDLE-n;
+    fileinfo[n].sequential = FALSE;
+    return claim_handle(n);
 #ifndef NONET
   }
 #endif
@@ -703,8 +1154,9 @@ int32 fileio_openup(char *name, int32 namelen) {
 ** 'close_file' is a function used locally to close a file or network channel
 */
 static void close_file(int32 handle) {
+  release_handle(handle);
 #ifndef NONET
-  if ((handle <= FIRSTHANDLE) && (fileinfo[handle].filetype == NETWORK)) {
+  if (fileinfo[handle].filetype == NETWORK) {
     brandynet_close(fileinfo[handle].nethandle);
     fileinfo[handle].stream = NIL;
     fileinfo[handle].filetype = CLOSED;
@@ -712,6 +1164,10 @@ static void close_file(int32 handle) {
     fileinfo[handle].nethandle = -1;
   } else {
 #endif
+#ifdef TARGET_UNIX
+    if (fileinfo[handle].mapbase!=NIL) munmap(fileinfo[handle].mapbase, fileinfo[handle].mapsize);
+#endif
+    fileinfo[handle].mapbase = NIL;
     fclose(fileinfo[handle].stream);
     fileinfo[handle].stream = NIL;
     fileinfo[handle].filetype = CLOSED;
@@ -728,7 +1184,7 @@ static void close_file(int32 handle) {
 void fileio_close(int32 handle) {
   int32 n;
   if (handle==0) {	/* Close all open files */
-    for (n=0; n<MAXFILES; n++) {
+    for (n=0; n<filecount; n++) {
       if (fileinfo[n].filetype!=CLOSED) close_file(n);
     }
   }
@@ -770,6 +1226,11 @@ int32 fileio_bget(int32 handle) {
       ch = asc_NUL;
       fileinfo[handle].eofstatus = PENDING;
     }
+    if (use_mapping(handle, 1)) {	/* File is mapped into memory */
+      if (fileinfo[handle].mappos<fileinfo[handle].mapsize) return fileinfo[handle].mapbase[fileinfo[handle].mappos++];
+      fileinfo[handle].eofstatus = PENDING;
+      return 0;
+    }
     if (fileinfo[handle].lastwaswrite) {		/* Ensure everything has been written to disk first */
       fflush(fileinfo[handle].stream);
       fileinfo[handle].lastwaswrite = FALSE;
@@ -786,6 +1247,40 @@ int32 fileio_bget(int32 handle) {
   return ch;
 }
 
+/*
+** 'getdol_mapped' is the version of 'fileio_getdol' for files mapped
+** into memory. It finds the end of the line with 'memchr' and gives the
+** same results as 'fgets' followed by 'strlen', including stopping at
+** a NUL character. It returns -1 if the line runs to the end of the
+** mapping and the file has changed size, in which case the line has
+** to be read through the C library
+*/
+static int32 getdol_mapped(int32 handle, char *buffer) {
+  byte *start, *p;
+  fileoffset left;
+  int32 length;
+
+  left = fileinfo[handle].mapsize-fileinfo[handle].mappos;
+  if (left<=0) {
+    if (!check_mapping(handle)) return -1;
+    error(ERR_CANTREAD);	/* Nothing left to read */
+  }
+  if (left>MAXSTRING-1) left = MAXSTRING-1;
+  start = fileinfo[handle].mapbase+fileinfo[handle].mappos;
+  p = memchr(start, asc_LF, left);
+  if (p==NIL && left<MAXSTRING-1 && !check_mapping(handle)) return -1;	/* Line might carry on past end of mapping */
+  length = p==NIL ? left : p-start+1;
+  fileinfo[handle].mappos+=length;
+  p = memchr(start, asc_NUL, length);
+  if (p!=NIL) length = p-start;
+  memcpy(buffer, start, length);
+  if (length>0 && start[length-1]==asc_LF) {	/* Got a 'linefeed' at the end of the line */
+    length--;
+    if (length>0 && start[length-1]==asc_CR) length--;	/* Got a 'carriage return-linefeed' pair */
+  }
+  return length;
+}
+
 /*
 ** 'fileio_getdol' reads a string from a file. It saves the text read at
 ** 'buffer'. Any terminating line end characters are removed. Both
@@ -805,6 +1300,13 @@ int32 fileio_getdol(int32 handle, char *buffer) {
     fileinfo[handle].eofstatus = ATEOF;
     error(ERR_HITEOF);
   }
+#ifndef NONET
+  if (fileinfo[handle].filetype==NETWORK) return net_getline(fileinfo[handle].nethandle, buffer, MAXSTRING);
+#endif
+  if (fileinfo[handle].mapbase!=NIL) {
+    length = getdol_mapped(handle, buffer);
+    if (length>=0) return length;
+  }
   if (fileinfo[handle].lastwaswrite) {		/* Ensure everything has been written to disk first */
     fflush(fileinfo[handle].stream);
     fileinfo[handle].lastwaswrite = FALSE;
@@ -820,13 +1322,86 @@ int32 fileio_getdol(int32 handle, char *buffer) {
   return length;
 }
 
-static int32 fileio_read(FILE *handle) {
+/*
+** 'fileio_getblock' reads up to 'count' bytes from file 'handle' into
+** memory starting at 'buffer' and returns the number of bytes read.
+** Unlike BGET#, running out of data is not an error here. It is up to
+** the caller to check the count returned, but any further attempt to
+** read the file will hit end-of-file as usual. As with BGET#, reading
+** a file once end-of-file has been reached is an error and only one
+** byte can be read from a file opened for output. With network
+** channels only the data already available is returned
+*/
+int32 fileio_getblock(int32 handle, byte *buffer, int32 count) {
+  int32 done;
+
+  if (handle==0) error(ERR_BADHANDLE);
+  handle = map_handle(handle);
+  if (count<=0) return 0;
+  if (fileinfo[handle].filetype!=NETWORK) {
+    if (fileinfo[handle].eofstatus!=OKAY) {	/* If EOF is pending, flag an error */
+      fileinfo[handle].eofstatus = ATEOF;
+      error(ERR_HITEOF);
+    }
+    else if (fileinfo[handle].filetype==OPENOUT) {	/* If file is open for output, read one char */
+      count = 1;
+      fileinfo[handle].eofstatus = PENDING;
+    }
+  }
+  if (use_mapping(handle, count)) {
+    fileoffset left = fileinfo[handle].mapsize-fileinfo[handle].mappos;
+    done = left<count ? (left>0 ? left : 0) : count;
+    memcpy(buffer, fileinfo[handle].mapbase+fileinfo[handle].mappos, done);
+    fileinfo[handle].mappos+=done;
+    if (done<count) fileinfo[handle].eofstatus = PENDING;
+    return done;
+  }
+#ifndef NONET
+  if (fileinfo[handle].filetype==NETWORK) {
+    int32 ch;
+    for (done=0; done<count; done++) {
+      ch = net_bget(fileinfo[handle].nethandle);
+      if (ch<0) break;	/* No more data for now or end of file */
+      buffer[done] = ch;
+    }
+    return done;
+  }
+#endif
+  if (fileinfo[handle].lastwaswrite) {		/* Ensure everything has been written to disk first */
+    fflush(fileinfo[handle].stream);
+    fileinfo[handle].lastwaswrite = FALSE;
+  }
+  done = fread(buffer, sizeof(byte), count, fileinfo[handle].stream);
+  if (done<count) fileinfo[handle].eofstatus = PENDING;
+  return done;
+}
+
+static int32 fileio_read(int32 handle) {
   int32 ch;
-  ch = fgetc(handle);
+  if (use_mapping(handle, 1)) {
+    if (fileinfo[handle].mappos>=fileinfo[handle].mapsize) error(ERR_CANTREAD);
+    return fileinfo[handle].mapbase[fileinfo[handle].mappos++];
+  }
+  ch = fgetc(fileinfo[handle].stream);
   if (ch==EOF) error(ERR_CANTREAD);
   return ch;
 }
 
+/*
+** 'fileio_readblock' reads the 'count' bytes of a value written by
+** PRINT# into 'buffer' in a single operation. It is an error if the
+** file does not contain that many bytes
+*/
+static void fileio_readblock(int32 handle, byte *buffer, int32 count) {
+  if (use_mapping(handle, count)) {
+    if (fileinfo[handle].mapsize-fileinfo[handle].mappos<count) error(ERR_CANTREAD);
+    memcpy(buffer, fileinfo[handle].mapbase+fileinfo[handle].mappos, count);
+    fileinfo[handle].mappos+=count;
+    return;
+  }
+  if (fread(buffer, sizeof(byte), count, fileinfo[handle].stream)!=count) error(ERR_CANTREAD);
+}
+
 /*
 ** 'fileio_getnumber' reads a binary number from the file with
 ** handle 'handle'. It stores the result at the address given
@@ -843,11 +1418,10 @@ static int32 fileio_read(FILE *handle) {
 ** byte floating point format
 */
 void fileio_getnumber(int32 handle, boolean *isint, int64 *ip, float64 *fp) {
-  FILE *stream;
   int32 n, marker;
+  byte block[sizeof(int64)];
   char temp[sizeof(float64)];
 
-  memset(temp,0,sizeof(float64));
   if (handle==0) error(ERR_BADHANDLE);
   handle = map_handle(handle);
   if (fileinfo[handle].eofstatus!=OKAY) {	/* If EOF is pending, flag an error */
@@ -858,47 +1432,48 @@ void fileio_getnumber(int32 handle, boolean *isint, int64 *ip, float64 *fp) {
     fflush(fileinfo[handle].stream);
     fileinfo[handle].lastwaswrite = FALSE;
   }
-  stream = fileinfo[handle].stream;
-  marker = fileio_read(stream);
+  marker = fileio_read(handle);
   switch (marker) {
   case PRINT_INT:
-    *ip = 0;
-    for (n=24; n>=0; n-=8) *ip |= fileio_read(stream) << n;
+    fileio_readblock(handle, block, sizeof(int32));
+    *ip = (int32)((uint32)block[0]<<24 | (uint32)block[1]<<16 | (uint32)block[2]<<8 | block[3]);
     *isint = TRUE;
     break;
   case PRINT_UINT8:
-    *ip = fileio_read(stream);
+    *ip = fileio_read(handle);
     *isint = TRUE;
     break;
-  case PRINT_INT64:
-    *ip = 0;
-    for (n=56; n>=0; n-=8) *ip |= fileio_read(stream) << n;
+  case PRINT_INT64: {
+    uint64 value = 0;
+    fileio_readblock(handle, block, sizeof(int64));
+    for (n=0; n<sizeof(int64); n++) value = value<<8 | block[n];
+    *ip = (int64)value;
     *isint = TRUE;
     break;
+  }
   case PRINT_FLOAT:
+    fileio_readblock(handle, block, sizeof(float64));
     switch (double_type) {
     case XMIXED_ENDIAN:
-      for (n=0; n<sizeof(float64); n++) temp[n] = fileio_read(stream);
+      for (n=0; n<sizeof(float64); n++) temp[n] = block[n];
       break;
     case XLITTLE_ENDIAN:
-      for (n=0; n<sizeof(float64); n++) temp[n^4] = fileio_read(stream);
+      for (n=0; n<sizeof(float64); n++) temp[n^4] = block[n];
       break;
     case XBIG_ENDIAN:
-      for (n=0; n<sizeof(float64); n++) temp[n^3] = fileio_read(stream);
+      for (n=0; n<sizeof(float64); n++) temp[n^3] = block[n];
       break;
     case XBIG_MIXED_ENDIAN:
-      for (n=0; n<sizeof(float64); n++) temp[n^7] = fileio_read(stream);
+      for (n=0; n<sizeof(float64); n++) temp[n^7] = block[n];
     }
     memmove(fp, temp, sizeof(float64));
     *isint = FALSE;
     break;
   case PRINT_FLOAT5: { /* Acorn's five byte format */
-    int32 exponent;
-    int32 mantissa = fileio_read(stream);
-    mantissa |= fileio_read(stream) << 8;
-    mantissa |= fileio_read(stream) << 16;
-    mantissa |= fileio_read(stream) << 24;
-    exponent = fileio_read(stream);
+    int32 exponent, mantissa;
+    fileio_readblock(handle, block, 5);
+    mantissa = (int32)(block[0] | (uint32)block[1]<<8 | (uint32)block[2]<<16 | (uint32)block[3]<<24);
+    exponent = block[4];
     if (exponent || mantissa) {
       *fp = ((mantissa & 0x7FFFFFFF) / 4294967296.0 + 0.5)
             * pow (2, exponent - 0x80)
@@ -924,7 +1499,6 @@ void fileio_getnumber(int32 handle, boolean *isint, int64 *ip, float64 *fp) {
 ** that is, the last character of the string is first.
 */
 int32 fileio_getstring(int32 handle, char *p) {
-  FILE *stream;
   int32 marker, length = 0, n;
 
   if (handle==0) error(ERR_BADHANDLE);
@@ -937,28 +1511,40 @@ int32 fileio_getstring(int32 handle, char *p) {
     fflush(fileinfo[handle].stream);
     fileinfo[handle].lastwaswrite = FALSE;
   }
-  stream = fileinfo[handle].stream;
-  marker = fileio_read(stream);
+  marker = fileio_read(handle);
   switch (marker) {
   case PRINT_SHORTSTR:	/* Reading short string in 'Acorn' format */
-    length = fileio_read(stream);
-    for (n=1; n<=length; n++) p[length-n] = fileio_read(stream);
+    length = fileio_read(handle);
+    fileio_readblock(handle, CAST(p, byte *), length);
+    for (n=0; n<length/2; n++) {	/* Put characters back in the right order */
+      char ch = p[n];
+      p[n] = p[length-1-n];
+      p[length-1-n] = ch;
+    }
     break;
-  case PRINT_LONGSTR:	/* Reading long string */
-    length = 0;		/* Start by reading the string length (four bytes, little endian) */
-    for (n=0; n<sizeof(int32); n++) length+=fileio_read(stream)<<(n*BYTESHIFT);
-    for (n=0; n<length; n++) p[n] = fileio_read(stream);
+  case PRINT_LONGSTR: {	/* Reading long string */
+    byte size[sizeof(int32)];	/* Start by reading the string length (four bytes, little endian) */
+    fileio_readblock(handle, size, sizeof(int32));
+    length = 0;
+    for (n=0; n<sizeof(int32); n++) length+=size[n]<<(n*BYTESHIFT);
+    fileio_readblock(handle, CAST(p, byte *), length);
     break;
+  }
   default:
     error(ERR_TYPESTR);
   }
   return length;
 }
 
-static void fileio_write(FILE *stream, int32 value) {
-  int32 result;
-  result = fputc(value, stream);
-  if (result==EOF) error(ERR_CANTWRITE);
+/*
+** 'fileio_writeblock' writes a value encoded by one of the PRINT#
+** functions to the file with index 'handle' in a single operation
+*/
+static void fileio_writeblock(int32 handle, byte *buffer, int32 count) {
+  if (fileinfo[handle].filetype==OPENIN) error(ERR_OPENIN);
+  fileinfo[handle].eofstatus = OKAY;
+  if (fwrite(buffer, sizeof(byte), count, fileinfo[handle].stream)!=count) error(ERR_CANTWRITE);
+  fileinfo[handle].lastwaswrite = TRUE;
 }
 
 /*
@@ -1014,44 +1600,35 @@ void fileio_bputstr(int32 handle, char *string, int32 length) {
 ** with the Acorn interpreter
 */
 void fileio_printint(int32 handle, int32 value) {
-  FILE *stream;
+  byte block[1+sizeof(int32)];
   int32 n;
 
   if (handle==0) error(ERR_BADHANDLE);
   handle = map_handle(handle);
-  if (fileinfo[handle].filetype==OPENIN) error(ERR_OPENIN);
-  fileinfo[handle].eofstatus = OKAY;
-  stream = fileinfo[handle].stream;
-  fileio_write(stream, PRINT_INT);
-  for (n=24; n>=0; n-=8) fileio_write(stream, value >> n);
-  fileinfo[handle].lastwaswrite = TRUE;
+  block[0] = PRINT_INT;
+  for (n=1; n<=sizeof(int32); n++) block[n] = value >> (32-n*8);
+  fileio_writeblock(handle, block, sizeof(block));
 }
 
 void fileio_printuint8(int32 handle, uint8 value) {
-  FILE *stream;
+  byte block[2];
 
   if (handle==0) error(ERR_BADHANDLE);
   handle = map_handle(handle);
-  if (fileinfo[handle].filetype==OPENIN) error(ERR_OPENIN);
-  fileinfo[handle].eofstatus = OKAY;
-  stream = fileinfo[handle].stream;
-  fileio_write(stream, PRINT_UINT8);
-  fileio_write(stream, value);
-  fileinfo[handle].lastwaswrite = TRUE;
+  block[0] = PRINT_UINT8;
+  block[1] = value;
+  fileio_writeblock(handle, block, sizeof(block));
 }
 
 void fileio_printint64(int32 handle, int64 value) {
-  FILE *stream;
+  byte block[1+sizeof(int64)];
   int32 n;
 
   if (handle==0) error(ERR_BADHANDLE);
   handle = map_handle(handle);
-  if (fileinfo[handle].filetype==OPENIN) error(ERR_OPENIN);
-  fileinfo[handle].eofstatus = OKAY;
-  stream = fileinfo[handle].stream;
-  fileio_write(stream, PRINT_INT64);
-  for (n=56; n>=0; n-=8) fileio_write(stream, value >> n);
-  fileinfo[handle].lastwaswrite = TRUE;
+  block[0] = PRINT_INT64;
+  for (n=1; n<=sizeof(int64); n++) block[n] = value >> (64-n*8);
+  fileio_writeblock(handle, block, sizeof(block));
 }
 
 /*
@@ -1063,31 +1640,28 @@ void fileio_printint64(int32 handle, int64 value) {
 ** code was written by Darren Salt
 */
 void fileio_printfloat(int32 handle, float64 value) {
-  FILE *stream;
+  byte block[1+sizeof(float64)];
   int32 n;
   char temp[sizeof(float64)];
 
   if (handle==0) error(ERR_BADHANDLE);
   handle = map_handle(handle);
-  if (fileinfo[handle].filetype==OPENIN) error(ERR_OPENIN);
-  fileinfo[handle].eofstatus = OKAY;
-  stream = fileinfo[handle].stream;
-  fileio_write(stream, PRINT_FLOAT);
+  block[0] = PRINT_FLOAT;
   memmove(temp, &value, sizeof(float64));
   switch (double_type) {
   case XMIXED_ENDIAN:
-    for (n=0; n<sizeof(float64); n++) fileio_write(stream, temp[n]);
+    for (n=0; n<sizeof(float64); n++) block[1+n] = temp[n];
     break;
   case XLITTLE_ENDIAN:
-    for (n=0; n<sizeof(float64); n++) fileio_write(stream, temp[n^4]);
+    for (n=0; n<sizeof(float64); n++) block[1+n] = temp[n^4];
     break;
   case XBIG_ENDIAN:
-    for (n=0; n<sizeof(float64); n++) fileio_write(stream, temp[n^3]);
+    for (n=0; n<sizeof(float64); n++) block[1+n] = temp[n^3];
     break;
   case XBIG_MIXED_ENDIAN:
-    for (n=0; n<sizeof(float64); n++) fileio_write(stream, temp[n^7]);
+    for (n=0; n<sizeof(float64); n++) block[1+n] = temp[n^7];
   }
-  fileinfo[handle].lastwaswrite = TRUE;
+  fileio_writeblock(handle, block, sizeof(block));
 }
 
 /*
@@ -1100,41 +1674,45 @@ void fileio_printfloat(int32 handle, float64 value) {
 ** character order
 */
 void fileio_printstring(int32 handle, char *string, int32 length) {
-  FILE *stream;
-  int32 n, temp, result;
+  byte block[1+SHORT_STRING];
+  int32 n, temp;
 
   if (handle==0) error(ERR_BADHANDLE);
   handle = map_handle(handle);
-  if (fileinfo[handle].filetype==OPENIN) error(ERR_OPENIN);
-  fileinfo[handle].eofstatus = OKAY;
-  stream = fileinfo[handle].stream;
   if (length<SHORT_STRING) {	/* Write string in Acorn format */
-    fileio_write(stream, PRINT_SHORTSTR);
-    fileio_write(stream, length);
-    if (length>0) for (n=length-1; n>=0; n--) fileio_write(stream, string[n]);
+    block[0] = PRINT_SHORTSTR;
+    block[1] = length;
+    for (n=0; n<length; n++) block[2+n] = string[length-1-n];
+    fileio_writeblock(handle, block, 2+length);
   }
   else {	/* Long string - Use interpreter's extended format */
-    fileio_write(stream, PRINT_LONGSTR);
+    block[0] = PRINT_LONGSTR;
     temp = length;
-    for (n=0; n<sizeof(int32); n++) {	/* Write four byte length to file */
-      fileio_write(stream, temp & BYTEMASK);
+    for (n=1; n<=sizeof(int32); n++) {	/* Four byte length */
+      block[n] = temp & BYTEMASK;
       temp = temp>>BYTESHIFT;
     }
-    result = fwrite(string, sizeof(char), length, stream);
-    if (result!=length) error(ERR_CANTWRITE);
+    fileio_writeblock(handle, block, 1+sizeof(int32));
+    fileio_writeblock(handle, CAST(string, byte *), length);
   }
-  fileinfo[handle].lastwaswrite = TRUE;
 }
 
 /*
 ** 'fileio_setptr' is used to set the current file pointer
 */
-void fileio_setptr(int32 handle, int32 newoffset) {
+void fileio_setptr(int32 handle, int64 newoffset) {
   int32 result;
 
   if (handle==0) error(ERR_BADHANDLE);
   handle = map_handle(handle);
-  result = fseek(fileinfo[handle].stream, newoffset, SEEK_SET);
+  if (newoffset<0 || newoffset!=(fileoffset)newoffset) error(ERR_SETPTRFAIL);
+  if (fileinfo[handle].sequential) stop_readahead(handle);
+  if (fileinfo[handle].mapbase!=NIL) {	/* File is mapped into memory */
+    fileinfo[handle].mappos = newoffset;
+    fileinfo[handle].eofstatus = OKAY;
+    return;
+  }
+  result = FSEEK(fileinfo[handle].stream, newoffset, SEEK_SET);
   if (result==-1) error(ERR_SETPTRFAIL);	/* File pointer cannot be set */
   fileinfo[handle].eofstatus = OKAY;
 }
@@ -1142,12 +1720,13 @@ void fileio_setptr(int32 handle, int32 newoffset) {
 /*
 ** 'fileio_getptr' returns the current value of the file pointer
 */
-int32 fileio_getptr(int32 handle) {
-  int32 result;
+int64 fileio_getptr(int32 handle) {
+  int64 result;
 
   if (handle==0) return 0; /* This is what happens on RISC OS 3.71 */
   handle = map_handle(handle);
-  result = TOINT(ftell(fileinfo[handle].stream));
+  if (fileinfo[handle].mapbase!=NIL) return fileinfo[handle].mappos;
+  result = FTELL(fileinfo[handle].stream);
   if (result==-1) error(ERR_GETPTRFAIL);	/* File pointer cannot be read */
   return result;
 }
@@ -1155,28 +1734,38 @@ int32 fileio_getptr(int32 handle) {
 /*
 ** 'fileio_getext' returns the size of a file
 */
-int32 fileio_getext(int32 handle) {
-  long int position, length;
+int64 fileio_getext(int32 handle) {
+  fileoffset position, length;
   FILE *stream;
 
   if (handle==0) error(ERR_BADHANDLE);
   handle = map_handle(handle);
+  if (check_mapping(handle)) return fileinfo[handle].mapsize;
   stream = fileinfo[handle].stream;
-  position = ftell(stream);
+  position = FTELL(stream);
   if (position==-1) error(ERR_GETEXTFAIL);	/* Cannot find size of file */
-  fseek(stream, 0, SEEK_END);			/* Find the end of the file */
-  length = ftell(stream);
-  fseek(stream, position, SEEK_SET);	/* Restore file to its original file pointer position */
-  return TOINT(length);
+  FSEEK(stream, 0, SEEK_END);			/* Find the end of the file */
+  length = FTELL(stream);
+  FSEEK(stream, position, SEEK_SET);	/* Restore file to its original file pointer position */
+  return length;
 }
 
 /*
-** 'fileio_setext' allows the size of a file to be changed. This
-** is not supported except under RISC OS
+** 'fileio_setext' allows the size of a file to be changed. Under
+** UNIX-type operating systems the file is truncated or extended
+** (with zeros) to the new size. Elsewhere this does nothing
 */
-void fileio_setext(int32 handle, int32 newsize) {
+void fileio_setext(int32 handle, int64 newsize) {
   handle = map_handle(handle);
-//error(ERR_UNSUPPORTED);
+#ifdef TARGET_UNIX
+#ifndef NONET
+  if (fileinfo[handle].filetype==NETWORK) error(ERR_UNSUPPORTED);
+#endif
+  if (fileinfo[handle].filetype==OPENIN) error(ERR_OPENIN);
+  if (newsize<0 || newsize!=(fileoffset)newsize) error(ERR_RANGE);
+  fflush(fileinfo[handle].stream);
+  if (ftruncate(fileno(fileinfo[handle].stream), newsize)==-1) error(ERR_CANTWRITE);
+#endif
 }
 
 /*
@@ -1187,10 +1776,14 @@ void fileio_setext(int32 handle, int32 newsize) {
 ** file pointer is equal to the size of the file) but if this
 ** fails it uses feof(). The snag with feof() is that it does
 ** not return TRUE under the same conditions as the Acorn
-** definition
+** definition. For ordinary files opened with OPENIN it is
+** enough to check whether there is another character to read,
+** which also sees any data another program has added to the file.
+** This is not done for pipes, terminals and devices, where looking
+** for the next character could wait for it to arrive
 */
 int32 fileio_eof(int32 handle) {
-  long position;
+  fileoffset position;
   FILE *stream;
   boolean ateof;
 
@@ -1201,18 +1794,116 @@ int32 fileio_eof(int32 handle) {
     return net_eof(fileinfo[handle].nethandle);
   } else {
 #endif
+  if (use_mapping(handle, 1)) return fileinfo[handle].mappos>=fileinfo[handle].mapsize;
   stream = fileinfo[handle].stream;
-  position = ftell(stream);
+  if (fileinfo[handle].filetype==OPENIN && fileinfo[handle].regular) {
+/*
+** Peek at the next character rather than seek to the end and back. The
+** seeks throw away the stdio buffer, so a 'WHILE NOT EOF#' loop would
+** otherwise go back to the operating system for every character read
+*/
+    int32 ch = getc(stream);
+    if (ch==EOF) {
+      clearerr(stream);
+      return TRUE;
+    }
+    ungetc(ch, stream);
+    return FALSE;
+  }
+  position = FTELL(stream);
   if (position==-1) return feof(stream) ? TRUE : FALSE;
-  fseek(stream, 0, SEEK_END);	/* Find the end of the file */
-  ateof = ftell(stream)==position;
-  fseek(stream, position, SEEK_SET);
+  FSEEK(stream, 0, SEEK_END);	/* Find the end of the file */
+  ateof = FTELL(stream)==position;
+  FSEEK(stream, position, SEEK_SET);
   return ateof;
 #ifndef NONET
   }
 #endif
 }
 
+/*
+** 'fileio_wait' waits until at least one of the 'count' files whose
+** handles are in 'handles' is ready for reading or writing, as asked
+** for by the NET_READABLE and NET_WRITABLE bits in the corresponding
+** entry in 'events'. On return each entry in 'events' says which of
+** the conditions hold. The function returns the number of handles
+** that are ready. 'timeout' is the longest time to wait in centi-
+** seconds, or -1 to wait for as long as it takes. Only network
+** handles ever have to be waited for: ordinary files are always
+** ready for whatever they were opened for
+*/
+int32 fileio_wait(int32 *handles, int32 *events, int32 count, int32 timeout) {
+  int32 n, found, netcount, ready;
+#ifndef NONET
+  int *nethandles;
+  int32 *netevents;
+#endif
+
+  if (count<0) error(ERR_RANGE);
+  found = netcount = 0;
+  for (n=0; n<count; n++) {
+    int32 entry = map_handle(handles[n]);
+    switch (fileinfo[entry].filetype) {
+    case NETWORK:
+      ready = 0;
+      netcount++;
+      break;
+    case OPENIN:
+      ready = NET_READABLE;
+      break;
+    case OPENOUT:
+      ready = NET_WRITABLE;
+      break;
+    default:
+      ready = NET_READABLE | NET_WRITABLE;
+    }
+    if (fileinfo[entry].filetype!=NETWORK && (ready & events[n])!=0) found++;
+  }
+#ifndef NONET
+  if (netcount>0) {
+    nethandles = malloc(netcount*sizeof(int));
+    netevents = malloc(netcount*sizeof(int32));
+    if (nethandles==NIL || netevents==NIL) {
+      free(nethandles);
+      free(netevents);
+      error(ERR_NOROOM);
+    }
+    netcount = 0;
+    for (n=0; n<count; n++) {
+      int32 entry = map_handle(handles[n]);
+      if (fileinfo[entry].filetype==NETWORK) {
+        nethandles[netcount] = fileinfo[entry].nethandle;
+        netevents[netcount] = events[n];
+        netcount++;
+      }
+    }
+    found+=net_wait(nethandles, netevents, netcount, found>0 ? 0 : timeout);
+    netcount = 0;
+    for (n=0; n<count; n++) {	/* Copy results back */
+      if (fileinfo[map_handle(handles[n])].filetype==NETWORK) events[n] = netevents[netcount++];
+    }
+    free(nethandles);
+    free(netevents);
+  }
+#endif
+  for (n=0; n<count; n++) {	/* Fill in results for ordinary files */
+    int32 entry = map_handle(handles[n]);
+    switch (fileinfo[entry].filetype) {
+    case NETWORK:
+      break;
+    case OPENIN:
+      events[n] &= NET_READABLE;
+      break;
+    case OPENOUT:
+      events[n] &= NET_WRITABLE;
+      break;
+    default:
+      events[n] &= NET_READABLE | NET_WRITABLE;
+    }
+  }
+  return found;
+}
+
 /*
 ** 'fileio_shutdown' is called at the end of a run to ensure that
 ** all files opened by the program have been closed
@@ -1220,7 +1911,7 @@ int32 fileio_eof(int32 handle) {
 void fileio_shutdown(void) {
   int32 n, count;
   count = 0;
-  for (n=0; n<MAXFILES; n++) {
+  for (n=0; n<filecount; n++) {
     if (fileinfo[n].filetype!=CLOSED) {
       close_file(n);
       count++;
@@ -1266,12 +1957,26 @@ static void find_floatformat(void) {
 ** 'init_fileio' is called to initialise the file handling
 */
 void init_fileio(void) {
-  int32 n;
-  for (n=0; n<MAXFILES; n++) {
-    fileinfo[n].stream = NIL;
-    fileinfo[n].filetype = CLOSED;
-    fileinfo[n].eofstatus = ATEOF;
+#ifdef TARGET_UNIX
+  struct rlimit limit;
+#endif
+  fileinfo = NIL;
+  slotmap = NIL;
+  filecount = firstslots = 0;
+  filelimit = MAXFILES;
+#ifdef TARGET_UNIX
+/*
+** The number of open files is limited by the number of file descriptors
+** the process may have. A few are kept back for the interpreter's own
+** use, for example for *SPOOL and *EXEC
+*/
+  if (getrlimit(RLIMIT_NOFILE, &limit)==0) {
+    if (limit.rlim_cur==RLIM_INFINITY || limit.rlim_cur>MAXFILELIMIT)
+      filelimit = MAXFILELIMIT;
+    else if (limit.rlim_cur>MAXFILES+16)
+      filelimit = limit.rlim_cur-16;
   }
+#endif
   find_floatformat();
 }
 
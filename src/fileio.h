@@ -34,6 +34,7 @@ extern int32 fileio_openup(char *, int32);
 extern void fileio_close(int32);
 extern int32 fileio_bget(int32);
 extern int32 fileio_getdol(int32, char *);
+extern int32 fileio_getblock(int32, byte *, int32);
 extern void fileio_getnumber(int32, boolean *, int64 *, float64 *);
 extern int32 fileio_getstring(int32, char *);
 extern void fileio_bput(int32, int32);
@@ -44,10 +45,19 @@ extern void fileio_printint64(int32, int64);
 extern void fileio_printfloat(int32, float64);
 extern void fileio_printstring(int32, char *, int32);
 extern int32 fileio_eof(int32);
-extern int32 fileio_getptr(int32);
-extern void fileio_setptr(int32, int32);
-extern int32 fileio_getext(int32);
-extern void fileio_setext(int32, int32);
+extern int32 fileio_wait(int32 *, int32 *, int32, int32);
+extern int32 fileio_accept(int32);
+extern void fileio_netcontrol(int32, int32, int32);
+extern void fileio_netflush(void);
+extern int32 fileio_netstatus(int32, int32 *);
+extern int32 fileio_sendbatch(int32, char *, int32 *, int32);
+extern int32 fileio_recvbatch(int32, char *, int32, int32 *, int32);
+extern int32 fileio_sendfile(int32, int32, int64, int64, int64 *);
+extern int32 fileio_recvfile(int32, int32, int64, int64 *);
+extern int64 fileio_getptr(int32);
+extern void fileio_setptr(int32, int64);
+extern int64 fileio_getext(int32);
+extern void fileio_setext(int32, int64);
 extern void fileio_shutdown(void);
 
 #endif
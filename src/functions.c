@@ -85,6 +85,9 @@
 
 static int32 lastrandom;		/* 32-bit pseudo-random number generator value */
 static int32 randomoverflow;		/* 1-bit overflow from pseudo-random number generator */
+
+#define FILLANES 4			/* Number of independent generators used to fill arrays */
+static uint64 fillstate[4][FILLANES];	/* xoshiro256** state for each generator used by 'RND(<array>)' */
 static float64 floatvalue;		/* Temporary for holding floating point values */
 
 /*
@@ -125,7 +128,7 @@ static void fn_himem(void) {
 static void fn_ext(void) {
   if (*basicvars.current != '#') error(ERR_HASHMISS);
   basicvars.current++;
-  push_int(fileio_getext(eval_intfactor()));
+  push_varyint(fileio_getext(eval_intfactor()));
 }
 
 /*
@@ -276,7 +279,7 @@ static void fn_page(void) {
 static void fn_ptr(void) {
   if (*basicvars.current == '#') {
     basicvars.current++;
-    push_int(fileio_getptr(eval_intfactor()));
+    push_varyint(fileio_getptr(eval_intfactor()));
   } else if (*basicvars.current == '(') {
     stackitem topitem;
     basicarray *descriptor;
@@ -598,29 +601,58 @@ static variable *get_arrayname(void) {
   return vp;
 }
 
+/*
+** 'get_arrayref' is used by the functions that operate on entire
+** arrays. It accepts either an array name, 'array()', or a slice of an
+** array such as 'array(2,)' or 'array(10 TO 19)'. It returns a pointer
+** to the array's descriptor and sets 'arraytype' to the array's type.
+** The descriptor of a slice is copied to 'view' as the original only
+** lasts as long as the reference to it on the Basic stack
+*/
+static basicarray *get_arrayref(basicarray *view, int32 *arraytype) {
+  variable *vp;
+  if (*basicvars.current == BASIC_TOKEN_ARRAYVAR
+   || (*basicvars.current == BASIC_TOKEN_XVAR && *(basicvars.current+LOFFSIZE+1) == ')')) {
+    vp = get_arrayname();
+    *arraytype = vp->varflags;
+    return vp->varentry.vararray;
+  }
+  (*factor_table[*basicvars.current])();
+  switch (GET_TOPITEM) {
+  case STACK_INTARRAY:   *arraytype = VAR_INTARRAY; break;
+  case STACK_UINT8ARRAY: *arraytype = VAR_UINT8ARRAY; break;
+  case STACK_INT64ARRAY: *arraytype = VAR_INT64ARRAY; break;
+  case STACK_FLOATARRAY: *arraytype = VAR_FLOATARRAY; break;
+  case STACK_STRARRAY:   *arraytype = VAR_STRARRAY; break;
+  default: error(ERR_VARARRAY);
+  }
+  *view = *pop_array();
+  return view;
+}
+
 /*
 ** 'fn_dim' handles the 'DIM' function. This returns either the number
 ** of dimensions the specified array has or the upper bound of the
 ** dimension given by the second parameter
 */
 void fn_dim(void) {
-  variable *vp;
-  int32 dimension;
+  basicarray *ap, view;
+  int32 dimension, arraytype;
   basicvars.current++;
   if (*basicvars.current != '(') error(ERR_SYNTAX);	/* DIM must be followed by a '(' */
   basicvars.current++;
-  vp = get_arrayname();
+  ap = get_arrayref(&view, &arraytype);
   switch (*basicvars.current) {
   case ',':	/* Got 'array(),<x>) - Return upper bound of dimension <x> */
     basicvars.current++;
     dimension = eval_integer();		/* Get dimension number */
     if (*basicvars.current != ')') error(ERR_RPMISS);
     basicvars.current++; 	/* Skip the trailing ')' */
-    if (dimension<1 || dimension>vp->varentry.vararray->dimcount) error(ERR_DIMRANGE);
-    push_int(vp->varentry.vararray->dimsize[dimension-1]-1);
+    if (dimension<1 || dimension>ap->dimcount) error(ERR_DIMRANGE);
+    push_int(ap->dimsize[dimension-1]-1);
     break;
   case ')':	/* Got 'array())' - Return the number of dimensions */
-    push_int(vp->varentry.vararray->dimcount);
+    push_int(ap->dimcount);
     basicvars.current++;
     break;
   default:
@@ -739,6 +771,7 @@ static void fn_get(void) {
     basicvars.current++;
     push_int(get_character_at_pos(x, y));
   } else {
+    fileio_netflush();
     do {
       ch=kbd_get() & 0xFF;
     } while (ch==0);
@@ -776,6 +809,7 @@ static void fn_getdol(void) {
   }
   else {	/* Normal 'GET$' - Return character read as a string */
     cp = alloc_string(1);
+    fileio_netflush();
     do {
       ch=kbd_get() & 0xFF;
     } while (ch==0);
@@ -789,7 +823,9 @@ static void fn_getdol(void) {
 ** OS_Byte 129 under a different name.
 */
 static void fn_inkey(void) {
-  push_int(kbd_inkey(eval_intfactor()));
+  int32 arg = eval_intfactor();
+  fileio_netflush();
+  push_int(kbd_inkey(arg));
 }
 
 /*
@@ -800,7 +836,9 @@ static void fn_inkey(void) {
 static void fn_inkeydol(void) {
   int32 result;
   char *cp;
-  result=kbd_inkey(eval_intfactor());
+  result=eval_intfactor();
+  fileio_netflush();
+  result=kbd_inkey(result);
   if (result == -1) {
     cp = alloc_string(0);
     push_strtemp(0, cp);
@@ -986,35 +1024,36 @@ static void fn_log(void) {
 void fn_mod(void) {
   static float64 fpsum;
   int32 n, elements;
-  variable *vp;
+  int32 arraytype;
+  basicarray *ap, view;
   basicvars.current++;		/* Skip MOD token */
   if(*basicvars.current == '(') {	/* One level of parentheses is allowed */
     basicvars.current++;
-    vp = get_arrayname();
+    ap = get_arrayref(&view, &arraytype);
     if (*basicvars.current != ')') error(ERR_RPMISS);
     basicvars.current++;
   }
   else {
-    vp = get_arrayname();
+    ap = get_arrayref(&view, &arraytype);
   }
-  elements = vp->varentry.vararray->arrsize;
-  switch (vp->varflags) {
+  elements = ap->arrsize;
+  switch (arraytype) {
   case VAR_INTARRAY: {	/* Calculate the modulus of an integer array */
-    int32 *p = vp->varentry.vararray->arraystart.intbase;
+    int32 *p = ap->arraystart.intbase;
     fpsum = 0;
     for (n=0; n<elements; n++) fpsum+=TOFLOAT(p[n])*TOFLOAT(p[n]);
     push_float(sqrt(fpsum));
     break;
   }
   case VAR_INT64ARRAY: {	/* Calculate the modulus of an integer array */
-    int64 *p = vp->varentry.vararray->arraystart.int64base;
+    int64 *p = ap->arraystart.int64base;
     fpsum = 0;
     for (n=0; n<elements; n++) fpsum+=TOFLOAT(p[n])*TOFLOAT(p[n]);
     push_float(sqrt(fpsum));
     break;
   }
   case VAR_FLOATARRAY: {	/* Calculate the modulus of a floating point array */
-    float64 *p = vp->varentry.vararray->arraystart.floatbase;
+    float64 *p = ap->arraystart.floatbase;
     fpsum = 0;
     for (n=0; n<elements; n++) fpsum+=p[n]*p[n];
     push_float(sqrt(fpsum));
@@ -1182,6 +1221,120 @@ static float64 randomfraction(void) {
   return TOFLOAT(reversed) / 4294967296.0;
 }
 
+/*
+** 'seed_fillrandom' seeds the generators used to fill arrays with
+** random numbers. Each of the four words of state of each generator
+** is set from successive values of the 'splitmix64' sequence started
+** at 'seed', as recommended by the authors of xoshiro256**
+*/
+static void seed_fillrandom(uint64 seed) {
+  int32 n, lane;
+  for (lane=0; lane<FILLANES; lane++) {
+    for (n=0; n<4; n++) {
+      uint64 z;
+      seed+=0x9E3779B97F4A7C15ull;
+      z = seed;
+      z = (z^(z>>30))*0xBF58476D1CE4E5B9ull;
+      z = (z^(z>>27))*0x94D049BB133111EBull;
+      fillstate[n][lane] = z^(z>>31);
+    }
+  }
+}
+
+#define ROTL64(x, k) (((x)<<(k)) | ((x)>>(64-(k))))
+
+/*
+** 'next_fillblock' steps each of the xoshiro256** generators used to
+** fill arrays, storing one 64-bit result from each in 'result'. The
+** generators are independent of each other so the loop can be
+** vectorised
+*/
+static void next_fillblock(uint64 result[FILLANES]) {
+  int32 lane;
+  for (lane=0; lane<FILLANES; lane++) {
+    uint64 s0 = fillstate[0][lane], s1 = fillstate[1][lane];
+    uint64 s2 = fillstate[2][lane], s3 = fillstate[3][lane], t;
+    result[lane] = ROTL64(s1*5, 7)*9;
+    t = s1<<17;
+    s2^=s0;
+    s3^=s1;
+    s1^=s2;
+    s0^=s3;
+    s2^=t;
+    fillstate[0][lane] = s0;
+    fillstate[1][lane] = s1;
+    fillstate[2][lane] = s2;
+    fillstate[3][lane] = ROTL64(s3, 45);
+  }
+}
+
+/*
+** 'fill_random' fills the numeric array 'ap' of type 'arraytype' with
+** random numbers. If 'limit' is greater than zero the values are
+** integers in the range 1 to 'limit', as returned by 'RND(<limit>)'.
+** Otherwise floating point arrays are filled with values in the range
+** 0 to 0.99999999 and integer arrays with values covering the full
+** range of the element type. A separate generator, xoshiro256**, is
+** used so that the sequence returned by 'RND' itself is not affected
+*/
+static void fill_random(basicarray *ap, int32 arraytype, int32 limit) {
+  int32 n, lane, elements;
+  uint64 block[FILLANES];
+  elements = ap->arrsize;
+
+/* Fill 'base' with the values given by 'conv', four elements at a time */
+
+#define FILL_ARRAY(base, conv) \
+  for (n=0; n<elements; n+=FILLANES) { \
+    next_fillblock(block); \
+    for (lane=0; lane<FILLANES && n+lane<elements; lane++) base[n+lane] = conv(block[lane]); \
+  }
+#define TO_LIMIT(x) (1+((((x)>>32)*(uint64)limit)>>32))	/* Top 32 bits scaled to 1..limit */
+#define TO_FLIMIT(x) TOFLOAT(TO_LIMIT(x))
+#define TO_INT32(x) ((int32)((x)>>32))
+#define TO_UINT8(x) ((uint8)((x)>>56))
+#define TO_FRACTION(x) (TOFLOAT((x)>>11)*(1.0/9007199254740992.0))	/* 53 bits scaled to 0..1 */
+
+  switch (arraytype) {
+  case VAR_INTARRAY:
+    if (limit>0) {
+      FILL_ARRAY(ap->arraystart.intbase, (int32)TO_LIMIT)
+    } else {
+      FILL_ARRAY(ap->arraystart.intbase, TO_INT32)
+    }
+    break;
+  case VAR_UINT8ARRAY:
+    if (limit>0) {
+      FILL_ARRAY(ap->arraystart.uint8base, (uint8)TO_LIMIT)
+    } else {
+      FILL_ARRAY(ap->arraystart.uint8base, TO_UINT8)
+    }
+    break;
+  case VAR_INT64ARRAY:
+    if (limit>0) {
+      FILL_ARRAY(ap->arraystart.int64base, (int64)TO_LIMIT)
+    } else {
+      FILL_ARRAY(ap->arraystart.int64base, (int64))
+    }
+    break;
+  case VAR_FLOATARRAY:
+    if (limit>0) {
+      FILL_ARRAY(ap->arraystart.floatbase, TO_FLIMIT)
+    } else {
+      FILL_ARRAY(ap->arraystart.floatbase, TO_FRACTION)
+    }
+    break;
+  default:
+    error(ERR_NUMARRAY);
+  }
+#undef FILL_ARRAY
+#undef TO_LIMIT
+#undef TO_FLIMIT
+#undef TO_INT32
+#undef TO_UINT8
+#undef TO_FRACTION
+}
+
 /*
 ** 'fn_rnd' evaluates the function 'RND'. See also fn_rndpar
 */
@@ -1195,12 +1348,36 @@ static void fn_rnd(void) {
 */
 static void fn_rndpar(void) {
   int32 value;
-  value = eval_integer();
+  stackitem topitem;
+  expression();
+  topitem = GET_TOPITEM;
+  if (topitem == STACK_INTARRAY || topitem == STACK_UINT8ARRAY || topitem == STACK_INT64ARRAY
+   || topitem == STACK_FLOATARRAY || topitem == STACK_STRARRAY) {	/* Got 'RND(<array>[,<limit>])' */
+    basicarray view;
+    int32 arraytype, limit;
+    arraytype = topitem == STACK_INTARRAY ? VAR_INTARRAY : topitem == STACK_UINT8ARRAY ? VAR_UINT8ARRAY :
+     topitem == STACK_INT64ARRAY ? VAR_INT64ARRAY : topitem == STACK_FLOATARRAY ? VAR_FLOATARRAY : VAR_STRARRAY;
+    view = *pop_array();	/* Copy descriptor as it might be that of an array slice */
+    if (arraytype == VAR_STRARRAY) error(ERR_NUMARRAY);
+    limit = 0;
+    if (*basicvars.current == ',') {
+      basicvars.current++;
+      limit = eval_integer();
+      if (limit<1 || (arraytype == VAR_UINT8ARRAY && limit>255)) error(ERR_RANGE);	/* Results must fit in the array */
+    }
+    if (*basicvars.current != ')') error(ERR_RPMISS);
+    basicvars.current++;
+    fill_random(&view, arraytype, limit);
+    push_int(view.arrsize);
+    return;
+  }
+  value = pop_anynum32();
   if (*basicvars.current != ')') error(ERR_RPMISS);
   basicvars.current++;
   if (value<0) {	/* Negative value = reseed random number generator */
     lastrandom = value;
     randomoverflow = 0;
+    seed_fillrandom((uint64)(int64)value);
     push_int(value);
   } else if (value == 0) {	/* Return last result */
     push_float(randomfraction());
@@ -1278,25 +1455,24 @@ static void fn_str(void) {
       else
         length = sprintf(basicvars.stringwork, "%X", pop_anynum32());
     else {
-      int32 format, numdigits;
-      char *fmt;
+      int32 format, numdigits, style;
       format = basicvars.staticvars[ATPERCENT].varentry.varinteger;
       if ((format & STRUSECHK) == 0) format = STRFORMAT;	/* Use predefined format, not @% */
       switch ((format>>2*BYTESHIFT) & BYTEMASK) {	/* Determine format of floating point values */
       case FORMAT_E:
-       fmt = "%.*E";
+        style = FORMAT_E;
         break;
       case FORMAT_F:
-        fmt = "%.*F";
+        style = FORMAT_F;
         break;
       default:	/* Assume anything else will be general format */
-        fmt = "%.*G";
+        style = FORMAT_G;
       }
       numdigits = (format>>BYTESHIFT) & BYTEMASK;
       if (numdigits == 0 && ((format>>2*BYTESHIFT) & BYTEMASK) != FORMAT_F) numdigits = DEFDIGITS;
       if (((format>>2*BYTESHIFT) & BYTEMASK) == FORMAT_E) numdigits--;
       if (numdigits > 17 ) numdigits = 17; /* Maximum meaningful length */
-      length = sprintf(basicvars.stringwork, fmt, numdigits, pop_anynumfp());
+      length = format_float(basicvars.stringwork, style, 0, numdigits, pop_anynumfp());
       if (format & COMMADPT) decimaltocomma(basicvars.stringwork, length);
       /* Hack to mangle the exponent format to BBC-style rather than C-style */
       bufptr = strchr(basicvars.stringwork,'E');
@@ -1356,6 +1532,33 @@ static void fn_string(void) {
   push_strtemp(newlen, base);
 }
 
+/*
+** 'sum_float64' adds up the 'count' floating point values starting at
+** 'p'. Rather than a simple running total, which loses precision as the
+** total grows and is a long chain of dependent additions, it uses
+** pairwise summation: the array is split in half recursively and the
+** halves summed separately. The blocks at the bottom of the recursion
+** are summed using eight independent partial totals so that the compiler
+** is free to use SIMD instructions for them. The rounding error grows
+** as O(log n) instead of O(n).
+*/
+#define SUMBLOCK 128		/* Number of elements summed directly by 'sum_float64' */
+
+static float64 sum_float64(float64 *p, int32 count) {
+  float64 part[8];
+  int32 n, m;
+  if (count > SUMBLOCK) {
+    m = (count/2) & ~7;		/* Keep the split on an eight element boundary */
+    return sum_float64(p, m) + sum_float64(p+m, count-m);
+  }
+  for (m=0; m<8; m++) part[m] = 0.0;
+  for (n=0; n+8<=count; n+=8) {
+    for (m=0; m<8; m++) part[m]+=p[n+m];
+  }
+  for (m=0; n<count; n++, m++) part[m]+=p[n];
+  return ((part[0]+part[1])+(part[2]+part[3]))+((part[4]+part[5])+(part[6]+part[7]));
+}
+
 /*
 ** 'fn_sum' implements the Basic functions 'SUM' and 'SUM LEN'. 'SUM'
 ** either calculates the sum of all the elements if a numeric array or
@@ -1364,35 +1567,35 @@ static void fn_string(void) {
 ** string array
 */
 static void fn_sum(void) {
-  int32 n, elements;
-  variable *vp;
+  int32 n, elements, arraytype;
+  basicarray *ap, view;
   boolean sumlen;
   sumlen = *basicvars.current == TYPE_FUNCTION && *(basicvars.current+1) == BASIC_TOKEN_LEN;
   if (sumlen) basicvars.current+=2;	/* Skip the 'LEN' token */
   if(*basicvars.current == '(') {	/* One level of parentheses is allowed */
     basicvars.current++;
-    vp = get_arrayname();
+    ap = get_arrayref(&view, &arraytype);
     if (*basicvars.current != ')') error(ERR_RPMISS);
     basicvars.current++;
   }
   else {
-    vp = get_arrayname();
+    ap = get_arrayref(&view, &arraytype);
   }
-  elements = vp->varentry.vararray->arrsize;
+  elements = ap->arrsize;
   if (sumlen) {		/* Got 'SUM LEN' */
     int32 length;
     basicstring *p;
-    if (vp->varflags != VAR_STRARRAY) error(ERR_TYPESTR);	/* Array is not a string array */
-    p = vp->varentry.vararray->arraystart.stringbase;
+    if (arraytype != VAR_STRARRAY) error(ERR_TYPESTR);	/* Array is not a string array */
+    p = ap->arraystart.stringbase;
     length = 0;
     for (n=0; n<elements; n++) length+=p[n].stringlen;	/* Find length of all strings in array */
     push_int(length);
   }
   else {	/* Got 'SUM' */
-    switch (vp->varflags) {
+    switch (arraytype) {
     case VAR_INTARRAY: {	/* Calculate sum of elements in an integer array */
       int32 intsum, *p;
-      p = vp->varentry.vararray->arraystart.intbase;
+      p = ap->arraystart.intbase;
       intsum = 0;
       for (n=0; n<elements; n++) intsum+=p[n];
       push_int(intsum);
@@ -1400,25 +1603,29 @@ static void fn_sum(void) {
     }
     case VAR_INT64ARRAY: {	/* Calculate sum of elements in an integer array */
       int64 intsum, *p;
-      p = vp->varentry.vararray->arraystart.int64base;
+      p = ap->arraystart.int64base;
       intsum = 0;
       for (n=0; n<elements; n++) intsum+=p[n];
       push_int(intsum);
       break;
     }
-    case VAR_FLOATARRAY: {	/* Calculate sum of elements in a floating point array */
-      float64 fpsum, *p;
-      fpsum = 0;
-      p = vp->varentry.vararray->arraystart.floatbase;
-      for (n=0; n<elements; n++) fpsum+=p[n];
-      push_float(fpsum);
+    case VAR_UINT8ARRAY: {	/* Calculate sum of elements in an unsigned 8-bit integer array */
+      int32 intsum;
+      uint8 *p;
+      p = ap->arraystart.uint8base;
+      intsum = 0;
+      for (n=0; n<elements; n++) intsum+=p[n];
+      push_int(intsum);
       break;
     }
+    case VAR_FLOATARRAY:	/* Calculate sum of elements in a floating point array */
+      push_float(sum_float64(ap->arraystart.floatbase, elements));
+      break;
     case VAR_STRARRAY: {	/* Concatenate all strings in a string array */
       int32 length, strlen;
       char *cp, *cp2;
       basicstring *p;
-      p = vp->varentry.vararray->arraystart.stringbase;
+      p = ap->arraystart.stringbase;
       length = 0;
       for (n=0; n<elements; n++) length+=p[n].stringlen;	/* Find length of result string */
       if (length>MAXSTRING) error(ERR_STRINGLEN);		/* String is too long */
@@ -1441,6 +1648,167 @@ static void fn_sum(void) {
   }
 }
 
+/*
+** 'array_extreme' finds the smallest ('wantmax' is FALSE) or the
+** largest ('wantmax' is TRUE) element of a numeric array for the
+** functions 'MIN(' and 'MAX('. If the optional second parameter is
+** supplied and is non-zero, the index of the element is returned
+** instead of its value. The index treats the array as if it had only
+** one dimension, so it runs from zero to the number of elements less
+** one. Where several elements have the same value, the index of the
+** first one is returned
+*/
+static void array_extreme(boolean wantmax) {
+  int32 n, elements, best;
+  boolean wantindex;
+  int32 arraytype;
+  basicarray *ap, view;
+  ap = get_arrayref(&view, &arraytype);
+  wantindex = FALSE;
+  if (*basicvars.current == ',') {
+    basicvars.current++;
+    wantindex = eval_integer() != 0;
+  }
+  if (*basicvars.current != ')') error(ERR_RPMISS);
+  basicvars.current++;
+  elements = ap->arrsize;
+  best = 0;
+  switch (arraytype) {
+  case VAR_INTARRAY: {
+    int32 *p = ap->arraystart.intbase;
+    if (wantmax) {
+      for (n=1; n<elements; n++) if (p[n] > p[best]) best = n;
+    } else {
+      for (n=1; n<elements; n++) if (p[n] < p[best]) best = n;
+    }
+    if (!wantindex) push_int(p[best]);
+    break;
+  }
+  case VAR_UINT8ARRAY: {
+    uint8 *p = ap->arraystart.uint8base;
+    if (wantmax) {
+      for (n=1; n<elements; n++) if (p[n] > p[best]) best = n;
+    } else {
+      for (n=1; n<elements; n++) if (p[n] < p[best]) best = n;
+    }
+    if (!wantindex) push_uint8(p[best]);
+    break;
+  }
+  case VAR_INT64ARRAY: {
+    int64 *p = ap->arraystart.int64base;
+    if (wantmax) {
+      for (n=1; n<elements; n++) if (p[n] > p[best]) best = n;
+    } else {
+      for (n=1; n<elements; n++) if (p[n] < p[best]) best = n;
+    }
+    if (!wantindex) push_int64(p[best]);
+    break;
+  }
+  case VAR_FLOATARRAY: {
+    float64 *p = ap->arraystart.floatbase;
+    if (wantmax) {
+      for (n=1; n<elements; n++) if (p[n] > p[best]) best = n;
+    } else {
+      for (n=1; n<elements; n++) if (p[n] < p[best]) best = n;
+    }
+    if (!wantindex) push_float(p[best]);
+    break;
+  }
+  default:
+    error(ERR_NUMARRAY);
+  }
+  if (wantindex) push_int(best);
+}
+
+/*
+** 'fn_min' returns the smallest element of a numeric array (or its
+** index). See 'array_extreme'
+*/
+static void fn_min(void) {
+  array_extreme(FALSE);
+}
+
+/*
+** 'fn_max' returns the largest element of a numeric array (or its
+** index). See 'array_extreme'
+*/
+static void fn_max(void) {
+  array_extreme(TRUE);
+}
+
+/*
+** 'get_element' returns element 'n' of numeric array 'ap' of type
+** 'arraytype' as a floating point value
+*/
+static float64 get_element(basicarray *ap, int32 arraytype, int32 n) {
+  switch (arraytype) {
+  case VAR_INTARRAY:	return TOFLOAT(ap->arraystart.intbase[n]);
+  case VAR_UINT8ARRAY:	return TOFLOAT(ap->arraystart.uint8base[n]);
+  case VAR_INT64ARRAY:	return TOFLOAT(ap->arraystart.int64base[n]);
+  default:		return ap->arraystart.floatbase[n];
+  }
+}
+
+/*
+** 'get_intelement' returns element 'n' of integer array 'ap' of type
+** 'arraytype' as a 64-bit integer
+*/
+static int64 get_intelement(basicarray *ap, int32 arraytype, int32 n) {
+  switch (arraytype) {
+  case VAR_INTARRAY:	return ap->arraystart.intbase[n];
+  case VAR_UINT8ARRAY:	return ap->arraystart.uint8base[n];
+  default:		return ap->arraystart.int64base[n];
+  }
+}
+
+/*
+** 'fn_dot' implements the function 'DOT('. This returns the sum of
+** the products of the corresponding elements of two numeric arrays,
+** that is, the dot or scalar product of the two arrays treated as
+** vectors. The arrays must have the same number of elements but are
+** not otherwise required to have the same shape. The result is an
+** integer if both arrays are integer arrays and floating point
+** otherwise. Two floating point arrays, the common case, are dealt
+** with using four partial totals so that the loop vectorises
+*/
+static void fn_dot(void) {
+  int32 n, elements, lhtype, rhtype;
+  basicarray *lhap, *rhap, lhview, rhview;
+  lhap = get_arrayref(&lhview, &lhtype);
+  if (*basicvars.current != ',') error(ERR_COMISS);
+  basicvars.current++;
+  rhap = get_arrayref(&rhview, &rhtype);
+  if (*basicvars.current != ')') error(ERR_RPMISS);
+  basicvars.current++;
+  if (lhtype == VAR_STRARRAY || rhtype == VAR_STRARRAY) error(ERR_NUMARRAY);
+  elements = lhap->arrsize;
+  if (rhap->arrsize != elements) error(ERR_TYPEARRAY);
+  if (lhtype == VAR_FLOATARRAY && rhtype == VAR_FLOATARRAY) {
+    float64 *lp, *rp, part0, part1, part2, part3;
+    lp = lhap->arraystart.floatbase;
+    rp = rhap->arraystart.floatbase;
+    part0 = part1 = part2 = part3 = 0.0;
+    for (n=0; n+4<=elements; n+=4) {
+      part0+=lp[n]*rp[n];
+      part1+=lp[n+1]*rp[n+1];
+      part2+=lp[n+2]*rp[n+2];
+      part3+=lp[n+3]*rp[n+3];
+    }
+    for (; n<elements; n++) part0+=lp[n]*rp[n];
+    push_float((part0+part1)+(part2+part3));
+  }
+  else if (lhtype == VAR_FLOATARRAY || rhtype == VAR_FLOATARRAY) {
+    float64 fpsum = 0.0;
+    for (n=0; n<elements; n++) fpsum+=get_element(lhap, lhtype, n)*get_element(rhap, rhtype, n);
+    push_float(fpsum);
+  }
+  else {
+    int64 intsum = 0;
+    for (n=0; n<elements; n++) intsum+=get_intelement(lhap, lhtype, n)*get_intelement(rhap, rhtype, n);
+    push_varyint(intsum);
+  }
+}
+
 /*
 ** 'fn_tan' calculates the tangent of its argument
 */
@@ -1804,7 +2172,8 @@ static void (*function_table[])(void) = {
   fn_sin, fn_sqr, fn_str, fn_string,  			/* 38..3B */
   fn_sum, fn_tan, fn_tempofn, fn_usr, 			/* 3C..3F */
   fn_val, fn_verify, fn_vpos, fn_sysfn,			/* 40..43 */
-  fn_rndpar, fn_xlatedol				/* 44..45 */
+  fn_rndpar, fn_xlatedol, fn_min, fn_max,		/* 44..47 */
+  fn_dot						/* 48 */
 };
 
 /*
@@ -1813,7 +2182,7 @@ static void (*function_table[])(void) = {
 void exec_function(void) {
   byte token = *(basicvars.current+1);
   basicvars.current+=2;
-  if (token>BASIC_TOKEN_XLATEDOL) bad_token();	/* Function token is out of range */
+  if (token>BASIC_TOKEN_LASTFN) bad_token();	/* Function token is out of range */
   (*function_table[token])();
 }
 
@@ -1824,4 +2193,5 @@ void init_functions(void) {
   srand( (unsigned)time( NULL ) );
   lastrandom=rand();
   randomoverflow = 0;
+  seed_fillrandom(((uint64)time(NULL)<<32) ^ (uint64)(uint32)lastrandom);
 }
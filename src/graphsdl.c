@@ -295,7 +295,7 @@ void add_mouseitem(int x, int y, int b, int64 c) {
   m->x = x;
   m->y = y;
   m->buttons = b;
-  m->timestamp = basicvars.centiseconds;
+  m->timestamp = mos_centiseconds();
   m->next=NULL;
 
   if (mousebuffer == NULL) {
@@ -329,7 +329,7 @@ static void drain_mouse_expired() {
   mousequeue *p;
   if (mouseqexpire == 0) return;
   while (mousebuffer != NULL) {
-    if ((mousebuffer->timestamp + mouseqexpire) > basicvars.centiseconds) break;
+    if ((mousebuffer->timestamp + mouseqexpire) > mos_centiseconds()) break;
     p=mousebuffer->next;
     free(mousebuffer);
     mousebuffer=p;
@@ -4579,7 +4579,7 @@ void get_sdl_mouse(size_t values[]) {
   values[0]=x;
   values[1]=y;
   values[2]=mousebuttonstate;
-  values[3]=basicvars.centiseconds - basicvars.monotonictimebase;
+  values[3]=mos_centiseconds() - basicvars.monotonictimebase;
 }
 
 void warp_sdlmouse(int32 x, int32 y) {
@@ -5114,7 +5114,7 @@ int videoupdatethread(void) {
         setup_mode(tmsg.modechange);
       }
     } else {
-      mytime = basicvars.centiseconds;
+      mytime = mos_centiseconds();
       if (matrixflags.noupdate == 0 && matrixflags.videothreadbusy == 0 && ds.autorefresh == 1 && matrixflags.surface) {
         matrixflags.videothreadbusy = 1;
         SDL_PumpEvents(); /* This is for the keyboard stuff */
@@ -58,6 +58,14 @@ static void *mymap (size_t size)
   char line[256] ;
   void *start, *finish, *base = (void *) 0x400000 ;
 
+/* Normally nothing is mapped at 'base', in which case there is no need to read the memory map */
+  start = mmap64 (base, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0) ;
+  if (start != MAP_FAILED) {
+    munmap (start, size) ;
+    if (start == base)
+      return base ;
+  }
+
   fp = fopen ("/proc/self/maps", "r") ;
   if (fp == NULL)
     return NULL ;
@@ -369,9 +369,18 @@ void exec_bput(void) {
     case STACK_STRING: case STACK_STRTEMP:
       stringtype = GET_TOPITEM;
       descriptor = pop_string();
-      fileio_bputstr(handle, descriptor.stringaddr, descriptor.stringlen);
-/* If string is last item on line, output a newline as well */
-      if (ateol[*basicvars.current]) fileio_bput(handle, '\n');
+/*
+** If string is last item on line, output a newline as well. The two are
+** written together so that they go in one datagram on a UDP socket
+*/
+      if (ateol[*basicvars.current] && descriptor.stringlen < MAXSTRING) {
+        memmove(basicvars.stringwork, descriptor.stringaddr, descriptor.stringlen);
+        basicvars.stringwork[descriptor.stringlen] = '\n';
+        fileio_bputstr(handle, basicvars.stringwork, descriptor.stringlen+1);
+      } else {
+        fileio_bputstr(handle, descriptor.stringaddr, descriptor.stringlen);
+        if (ateol[*basicvars.current]) fileio_bput(handle, '\n');
+      }
       if (stringtype == STACK_STRTEMP) free_string(descriptor);
       break;
     default:	/* Item is neither a number nor a string */
@@ -1360,8 +1369,7 @@ void exec_pointto(void) {
 static void print_screen(void) {
   stackitem resultype;
   boolean hex, rightjust, newline;
-  int32 format, fieldwidth, numdigits, size;
-  char *leftfmt, *rightfmt;
+  int32 format, fieldwidth, numdigits, size, style;
   char *bufptr;
 
 #ifdef DEBUG
@@ -1377,15 +1385,15 @@ static void print_screen(void) {
   switch ((format>>2*BYTESHIFT) & BYTEMASK) {	/* Determine format of floating point values */
   case FORMAT_E:
     if (numdigits == 0) numdigits = DEFDIGITS;	/* Use default of 17 digits if value is 0 */
-    leftfmt = "%.*E"; rightfmt = "%*.*E";
+    style = FORMAT_E;
     if (numdigits > 1) numdigits--;
     break;
   case FORMAT_F:
-    leftfmt = "%.*F"; rightfmt = "%*.*F";
+    style = FORMAT_F;
     break;
   default:	/* Assume anything else will be general format */
     if (numdigits == 0) numdigits = DEFDIGITS;	/* Use default of 17 digits if value is 0 */
-    leftfmt = "%.*G"; rightfmt = "%*.*G";
+    style = FORMAT_G;
     break;
   }
   while (!ateol[*basicvars.current]) {
@@ -1455,7 +1463,7 @@ static void print_screen(void) {
           else
             size = sprintf(basicvars.stringwork, "%*X", fieldwidth, pop_anynum32());
         } else {
-          size = sprintf(basicvars.stringwork, rightfmt, fieldwidth, numdigits, pop_anynumfp());
+          size = format_float(basicvars.stringwork, style, fieldwidth, numdigits, pop_anynumfp());
         }
       } 
       else {	/* Left justify the value */
@@ -1465,7 +1473,7 @@ static void print_screen(void) {
           else
             size = sprintf(basicvars.stringwork, "%X", pop_anynum32());
         else {
-          size = sprintf(basicvars.stringwork, leftfmt, numdigits, pop_anynumfp());
+          size = format_float(basicvars.stringwork, style, 0, numdigits, pop_anynumfp());
         }
       }
       if (format & COMMADPT) decimaltocomma(basicvars.stringwork, size);
@@ -111,6 +111,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
 #include "common.h"
 #include "target.h"
 #include "basicdefs.h"
@@ -704,7 +705,7 @@ int64 tmp;
   if (backgnd_escape) {				/* Only poll when not doing key input	*/
     if (kbd_esctest()) {			/* Only poll if Escapes are enabled	*/
 #ifdef USE_SDL
-      tmp=basicvars.centiseconds;
+      tmp=mos_centiseconds();
       if (tmp > esclast) {
         esclast=tmp;
         if (kbd_inkey(-113)) basicvars.escape=TRUE;	// Should check key character, not keycode
@@ -971,13 +972,13 @@ int32 kbd_inkey(int32 arg) {
           if (ev.button.button == SDL_BUTTON_LEFT) mousebuttonstate |= 4;
           if (ev.button.button == SDL_BUTTON_MIDDLE) mousebuttonstate |= 2;
           if (ev.button.button == SDL_BUTTON_RIGHT) mousebuttonstate |= 1;
-          add_mouseitem(mx, my, mousebuttonstate, basicvars.centiseconds);
+          add_mouseitem(mx, my, mousebuttonstate, mos_centiseconds());
           break;
         case SDL_MOUSEBUTTONUP:
           if (ev.button.button == SDL_BUTTON_LEFT) mousebuttonstate &= 3;
           if (ev.button.button == SDL_BUTTON_MIDDLE) mousebuttonstate &= 5;
           if (ev.button.button == SDL_BUTTON_RIGHT) mousebuttonstate &= 6;
-          add_mouseitem(mx, my, mousebuttonstate, basicvars.centiseconds);
+          add_mouseitem(mx, my, mousebuttonstate, mos_centiseconds());
           break;
       }
     }
@@ -1454,7 +1455,7 @@ void osbyte21(int32 xreg) {
 void checkforescape(void) {
 #ifdef USE_SDL
 int64 i;
-  i=basicvars.centiseconds;
+  i=mos_centiseconds();
   if (i > esclast) {
     esclast=i;
 // Should check key character, not keycode
@@ -1492,19 +1493,23 @@ static boolean waitkey(int wait) {
 */
 static boolean waitkey(int wait) {
 #ifdef USE_SDL
-  int64 timerstart;
+  int64 timerstart, remaining;
   int mx, my;
 #endif
 #if (defined(USE_SDL) && !defined(TARGET_MINGW)) || !defined(USE_SDL)
   fd_set keyset;
   struct timeval waitime;
 #endif
+#if !defined(USE_SDL) && !defined(BODGEMGW)
+  int64 deadline, remaining;
+  int result;
+#endif
 #ifdef BODGEMGW
   int tmp;
 #endif
 
 #ifdef USE_SDL
-  timerstart = basicvars.centiseconds;
+  timerstart = mos_microseconds();
   SDL_Event ev;
   while ( 1 ) {
 /*
@@ -1535,20 +1540,20 @@ static boolean waitkey(int wait) {
           if (ev.button.button == SDL_BUTTON_LEFT) mousebuttonstate |= 4;
           if (ev.button.button == SDL_BUTTON_MIDDLE) mousebuttonstate |= 2;
           if (ev.button.button == SDL_BUTTON_RIGHT) mousebuttonstate |= 1;
-          add_mouseitem(mx, my, mousebuttonstate, basicvars.centiseconds);
+          add_mouseitem(mx, my, mousebuttonstate, mos_centiseconds());
           break;
         case SDL_MOUSEBUTTONUP:
           if (ev.button.button == SDL_BUTTON_LEFT) mousebuttonstate &= 3;
           if (ev.button.button == SDL_BUTTON_MIDDLE) mousebuttonstate &= 5;
           if (ev.button.button == SDL_BUTTON_RIGHT) mousebuttonstate &= 6;
-          add_mouseitem(mx, my, mousebuttonstate, basicvars.centiseconds);
+          add_mouseitem(mx, my, mousebuttonstate, mos_centiseconds());
           break;
         case SDL_QUIT:
           exit_interpreter(EXIT_SUCCESS);
           break;
       }
     }
-    if (basicvars.centiseconds - timerstart >= wait) return 0;
+    if (mos_microseconds() - timerstart >= (int64)wait * 10000) return 0;
 
 #ifndef TARGET_MINGW
 /*
@@ -1561,8 +1566,9 @@ static boolean waitkey(int wait) {
     waitime.tv_sec = waitime.tv_usec = 0;
     if (!nokeyboard && select(1, &keyset, NIL, NIL, &waitime) > 0 ) return 1;
 #endif /* !TARGET_MINGW */
-    if (basicvars.centiseconds - timerstart >= wait) return 0; /* return after one check if wait time = 0, or after timeout. */
-    usleep(1000);
+    remaining = (int64)wait * 10000 - (mos_microseconds() - timerstart);
+    if (remaining <= 0) return 0; /* return after one check if wait time = 0, or after timeout. */
+    usleep(remaining < 1000 ? remaining : 1000);	/* SDL 1.2 cannot wait for an event with a timeout */
   }
 #else /* !USE_SDL */
 #ifdef BODGEMGW
@@ -1570,11 +1576,22 @@ static boolean waitkey(int wait) {
   for(;;) { if(kbhit() || (clock()>tmp)) break; }
   return kbhit();
 #else
-  FD_ZERO(&keyset);
-  FD_SET(keyboard, &keyset);
-  waitime.tv_sec = wait/100;    /* Convert wait time to seconds and microseconds */
-  waitime.tv_usec = wait%100*10000;
-  return select(1, &keyset, NIL, NIL, &waitime) > 0;
+/*
+** Sleep in select() until a key is pressed or the time is up. Escape
+** raises SIGINT, which interrupts the wait. Any other signal just
+** means waiting again for whatever time is left
+*/
+  deadline = mos_microseconds() + (int64)wait * 10000;
+  do {
+    remaining = deadline - mos_microseconds();
+    if (remaining < 0) remaining = 0;
+    FD_ZERO(&keyset);
+    FD_SET(keyboard, &keyset);
+    waitime.tv_sec = remaining / 1000000;    /* Convert wait time to seconds and microseconds */
+    waitime.tv_usec = remaining % 1000000;
+    result = select(1, &keyset, NIL, NIL, &waitime);
+  } while (result < 0 && errno == EINTR && !basicvars.escape && remaining > 0);
+  return result > 0;
 #endif
 #endif
 }
@@ -1629,13 +1646,13 @@ int32 read_key(void) {
           if (ev.button.button == SDL_BUTTON_LEFT) mousebuttonstate |= 4;
           if (ev.button.button == SDL_BUTTON_MIDDLE) mousebuttonstate |= 2;
           if (ev.button.button == SDL_BUTTON_RIGHT) mousebuttonstate |= 1;
-          add_mouseitem(mx, my, mousebuttonstate, basicvars.centiseconds);
+          add_mouseitem(mx, my, mousebuttonstate, mos_centiseconds());
           break;
         case SDL_MOUSEBUTTONUP:
           if (ev.button.button == SDL_BUTTON_LEFT) mousebuttonstate &= 3;
           if (ev.button.button == SDL_BUTTON_MIDDLE) mousebuttonstate &= 5;
           if (ev.button.button == SDL_BUTTON_RIGHT) mousebuttonstate &= 6;
-          add_mouseitem(mx, my, mousebuttonstate, basicvars.centiseconds);
+          add_mouseitem(mx, my, mousebuttonstate, mos_centiseconds());
           break;
         case SDL_KEYUP:
           break;
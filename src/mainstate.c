@@ -1619,6 +1619,49 @@ void exec_on(void) {
   }
 }
 
+/*
+** 'clear_response' discards the current contents of the string array
+** that will hold the output of a command run by 'OSCLI ... TO' and
+** returns a pointer to the array
+*/
+static basicarray *clear_response(lvalue response) {
+  basicarray *ap;
+  basicstring descriptor;
+  int n;
+
+  ap = *response.address.arrayaddr;
+  descriptor.stringlen = 0;
+  descriptor.stringaddr = nullstring;	/* Found in variables.c */
+  for (n=0; n<ap->arrsize; n++) {
+    free_string(ap->arraystart.stringbase[n]);
+    ap->arraystart.stringbase[n] = descriptor;
+  }
+  return ap;
+}
+
+/*
+** 'save_response' stores a line of the output from a command run by
+** 'OSCLI ... TO' in the next element of string array 'ap', updating
+** the count of lines stored in '*count'. 'atend' is TRUE if this is
+** the last line of the output and it does not end with a newline
+*/
+static void save_response(basicarray *ap, int *count, char *p, int length, boolean atend) {
+  basicstring descriptor;
+
+  if (length>0 && p[0] == '\r') {	/* Remove possible CR at the start of the line */
+    p++;
+    length--;
+  }
+  while (length>0 && (p[length-1] == '\n' || p[length-1] == '\r' || p[length-1] == ' ')) length--;
+  if (length>0 || !atend) {	/* Don't want an empty line at the end of the array */
+    descriptor.stringlen = length;
+    descriptor.stringaddr = alloc_string(length);
+    if (length>0) memmove(descriptor.stringaddr, p, length);
+    (*count)++;
+    ap->arraystart.stringbase[*count] = descriptor;
+  }
+}
+
 /*
 ** 'exec_oscli' issues an OS command.
 ** The interpreter supports and extended 'OSCLI ... TO' version of
@@ -1629,9 +1672,10 @@ void exec_oscli(void) {
   basicstring descriptor;
   lvalue response, linecount;
   boolean tofile;
-  char *oscli_string;
+  char *oscli_string, *output, *p, *lf;
   char respname[FNAMESIZE];
   int count, n;
+  int32 outlen;
   FILE *respfile, *respfh;
   basicarray *ap;
 
@@ -1665,8 +1709,27 @@ void exec_oscli(void) {
     return;
   }
 /*
-** Issue the command and then read the command response
+** Issue the command and then read the command response. Where the
+** output can be captured directly, it is split into lines here,
+** otherwise it goes via a temporary file
 */
+  output = mos_oscli_capture(oscli_string, &outlen);
+  if (output != NIL) {
+    free(oscli_string);
+    ap = clear_response(response);
+    count = 0;
+    p = output;
+    while (p < output+outlen && count+1<ap->arrsize) {
+      lf = memchr(p, '\n', output+outlen-p);
+      n = lf == NIL ? output+outlen-p : lf-p+1;
+      if (n > MAXSTRING-1) n = MAXSTRING-1;	/* Split long lines in the same way as reading them from a file */
+      save_response(ap, &count, p, n, p+n >= output+outlen && p[n-1] != '\n');
+      p+=n;
+    }
+    free(output);
+    if (linecount.typeinfo != 0) store_value(linecount, count, NOSTRING);
+    return;
+  }
   respfh=secure_tmpnam(respname);
   if (!respfh) {
     free(oscli_string);
@@ -1677,18 +1740,10 @@ void exec_oscli(void) {
   free(oscli_string);
   respfile = fopen(respname, "rb");
   if (respfile == 0) return;
-  ap = *response.address.arrayaddr;
-/* Start by discarding the current contents of the array */
-  descriptor.stringlen = 0;
-  descriptor.stringaddr = nullstring;	/* Found in variables.c */
-  for (n=0; n<ap->arrsize; n++) {
-    free_string(ap->arraystart.stringbase[n]);
-    ap->arraystart.stringbase[n] = descriptor;
-  }
+  ap = clear_response(response);
   count = 0;	/* Number of lines read */
   while (!feof(respfile) && count+1<ap->arrsize) {	/* Read the command output */
-    int length;
-    char *p = fgets(basicvars.stringwork, MAXSTRING, respfile);
+    p = fgets(basicvars.stringwork, MAXSTRING, respfile);
     if (p == NIL) {	/* Either an error or EOF reached and no data read */
       if (!ferror(respfile)) break;		/* End of file and no data read */
       fclose(respfile);
@@ -1697,17 +1752,7 @@ void exec_oscli(void) {
     }
 /* Remove any CRs or LFs or trailing blanks in the line and copy it to the string array */
     if (p == NIL) break;
-    p = basicvars.stringwork;
-    if (p[0] == '\r') p++;	/* Remove possible CR at the start of the line */
-    length = strlen(p);
-    while (length>0 && (p[length-1] == '\n' || p[length-1] == '\r' || p[length-1] == ' ')) length--;
-    if (length>0 || !feof(respfile)) {	/* Don't want an empty line at the end of the array */
-      descriptor.stringlen = length;
-      descriptor.stringaddr = alloc_string(length);
-      if (length>0) memmove(descriptor.stringaddr, p, length);
-      count++;
-      ap->arraystart.stringbase[count] = descriptor;
-    }
+    save_response(ap, &count, p, strlen(p), feof(respfile));
   }
   fclose(respfile);
   remove(respname);
@@ -2344,7 +2389,9 @@ void exec_sys(void) {
   stackitem parmtype;
   basicstring descriptor, tempdesc[MAXSYSPARMS];
   lvalue destination;
+  byte *swiname;
   basicvars.current++;
+  swiname = basicvars.current;
   expression();		/* Fetch the SWI name or number */
   parmtype = GET_TOPITEM;
   switch (parmtype) {	/* Untangle the SWI number */
@@ -2355,6 +2402,15 @@ void exec_sys(void) {
     descriptor = pop_string();
     swino = mos_getswinum(descriptor.stringaddr, descriptor.stringlen, 0);
     if (parmtype == STACK_STRTEMP) free_string(descriptor);
+/*
+** If the SWI name is a string constant on its own, replace it in the
+** tokenised code with the SWI number so that it does not have to be
+** looked up again the next time the statement is executed. The two
+** are the same size. LIST uses the source part of the line, so the
+** name is still shown there
+*/
+    if (*swiname == BASIC_TOKEN_STRINGCON && basicvars.current == swiname+1+OFFSIZE+SIZESIZE
+     && OFFSIZE+SIZESIZE == INTSIZE) set_intconst(swiname, swino);
     break;
   default:
     error(ERR_TYPENUM);
@@ -2364,8 +2420,11 @@ void exec_sys(void) {
     outregs[n] = inregs[n].i = 0;
     inregs[MAXSYSPARMS+n].f = 0.0;
     tempdesc[n].stringaddr = NIL;
+    basicvars.sysarrays[n] = 0;
   }
   parmcount = 0; ip = 0; fp = MAXSYSPARMS+1;
+  basicvars.sysfloats = 0;
+  flags = 0;
   if (*basicvars.current == ',') basicvars.current++;
 /* Now gather the parameters for the SWI call */
   while (!ateol[*basicvars.current] && *basicvars.current != BASIC_TOKEN_TO) {
@@ -2382,6 +2441,7 @@ void exec_sys(void) {
         break;
 #ifndef TARGET_RISCOS
       case STACK_FLOAT:
+        basicvars.sysfloats |= 1u<<(ip+fp-(MAXSYSPARMS+1));	/* Position among the parameters given */
         inregs[fp].f = pop_float();
         fp++;
         break;
@@ -2401,6 +2461,19 @@ void exec_sys(void) {
         ip++;
         break;
       }
+      case STACK_INTARRAY: case STACK_UINT8ARRAY: case STACK_INT64ARRAY: case STACK_FLOATARRAY: {
+/*
+** Pass the address of the array's first element. Its size is noted so
+** that calls that transfer data to or from the array can check that
+** it is big enough
+*/
+        basicarray *ap = pop_array();
+        inregs[ip].i = (size_t)ap->arraystart.arraybase;
+        basicvars.sysarrays[ip] = (size_t)ap->arrsize * (parmtype == STACK_UINT8ARRAY ? sizeof(uint8)
+         : parmtype == STACK_INTARRAY ? sizeof(int32) : parmtype == STACK_INT64ARRAY ? sizeof(int64) : sizeof(float64));
+        ip++;
+        break;
+      }
       default:
         error(ERR_VARNUMSTR);	/* Parameter must be an integer or string value */
       }
@@ -2555,6 +2628,7 @@ void exec_wait(void) {
   else {	/* WAIT <time to wait> */
     int32 delay = eval_integer();
     check_ateol();
+    fileio_netflush();
     mos_waitdelay(delay);
   }
 }
@@ -37,6 +37,7 @@
 #include "tokens.h"
 #include "errors.h"
 #include "keyboard.h"
+#include "fileio.h"
 #include "screen.h"
 #include "miscprocs.h"
 
@@ -430,6 +431,7 @@ static void strip(char line[]) {
 boolean read_line(char line[], int32 linelen) {
   readstate result;
   line[0] = asc_NUL;
+  fileio_netflush();
   result = kbd_readline(line, linelen, 0);
   result = READ_OK;	/* temp'y bodge */
   if (result==READ_ESC || basicvars.escape) error(ERR_ESCAPE);
@@ -450,6 +452,7 @@ boolean read_line(char line[], int32 linelen) {
 */
 boolean amend_line(char line[], int32 linelen) {
   readstate result;
+  fileio_netflush();
   result = kbd_readline(line, linelen,0);
   result = READ_OK;	/* temp'y bodge */
   if (result==READ_ESC || basicvars.escape) error(ERR_ESCAPE);
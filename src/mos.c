@@ -104,6 +104,14 @@
 #include <unistd.h>
 #endif
 
+#ifdef TARGET_UNIX
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+extern char **environ;
+#endif
+
 #ifdef USE_SDL
 #include "SDL.h"
 #include "graphsdl.h"
@@ -117,6 +125,7 @@ static void mos_osword(int32 areg, int64 xreg);
 static int32 mos_osbyte(int32 areg, int32 xreg, int32 yreg, int32 xflag);
 
 static void native_oscli(char *command, char *respfile, FILE *respfh);
+static char *oscli_command(char *command);
 #endif
 
 /* Address range used to identify emulated calls to the BBC Micro MOS */
@@ -175,7 +184,7 @@ static void show_meminfo() {
   emulate_printf("  Video frame buffer is at &" FMT_SZX ", size &%X\r\n", matrixflags.modescreen_ptr, matrixflags.modescreen_sz);
   emulate_printf("  MODE 7 Teletext frame buffer is at &" FMT_SZX "\r\n", MODE7FB);
 #endif /* USE_SDL */
-  if (matrixflags.gpio) emulate_printf("  GPIO interface mapped at &" FMT_SZX "\r\n", matrixflags.gpiomem);
+  if (mos_gpio()) emulate_printf("  GPIO interface mapped at &" FMT_SZX "\r\n", matrixflags.gpiomem);
 }
 
 static void cmd_brandyinfo() {
@@ -296,17 +305,14 @@ int32 mos_usr(int32 address) {
 #define CONTROL_MOUSE 21	/* OS_Word call number to control the mouse pointer */
 #define SELECT_MOUSE 106	/* OS_Byte call number to select a mouse pointer */
 
-/* Processor flag bits used in mos_sys() */
-
-#define OVERFLOW_FLAG 1
-#define CARRY_FLAG 2
-#define ZERO_FLAG 4
-#define NEGATIVE_FLAG 8
 
 
 int64 mos_centiseconds(void) {
-  basicvars.centiseconds = clock();
-  return basicvars.centiseconds; // (clock() * 100) / CLOCKS_PER_SEC;
+  return clock(); // (clock() * 100) / CLOCKS_PER_SEC;
+}
+
+int64 mos_microseconds(void) {
+  return (int64)clock() * 10000;
 }
 
 
@@ -658,6 +664,15 @@ void mos_oscli(char *command, char *respfile, FILE *respfh) {
   }
 }
 
+/*
+** 'mos_oscli_capture' would run a command and return its output. It is
+** not supported under RISC OS, where the caller has to fall back to
+** redirecting the output to a file
+*/
+char *mos_oscli_capture(char *command, int32 *length) {
+  return NIL;
+}
+
 /* This gets the virtual SWI num of Brandy-specific calls that are only valid within Matrix Brandy */
 static int32 mos_getswinum2(char *name, int32 length, int32 inxflag) {
   int32 ptr;
@@ -755,8 +770,11 @@ void mos_final(void) {
 #if (defined(TARGET_WIN32) | defined(TARGET_AMIGA)) && !defined(TARGET_MINGW)
 
 int64 mos_centiseconds(void) {
-  basicvars.centiseconds = (clock() * 100) / CLOCKS_PER_SEC
-  return basicvars.centiseconds;
+  return ((int64)clock() * 100) / CLOCKS_PER_SEC;
+}
+
+int64 mos_microseconds(void) {
+  return ((int64)clock() * 1000000) / CLOCKS_PER_SEC;
 }
 
 
@@ -786,16 +804,32 @@ void mos_wrtime(int32 time) {
 ** depends on the underlying OS.
 ** This code was supplied by Jeff Doggett, and modified
 ** by Michael McConnell
-** Further modified by moving code into brandy.c and running in a
-** separate thread that updates basicvars.centiseconds.
+** The clock is read when it is needed rather than being updated by
+** a separate thread. clock_gettime() does not make a system call on
+** Linux, so this is cheaper than waking up a thread every 5ms and
+** gives the full resolution of the clock.
 */
 
 int64 mos_centiseconds(void) {
-  return basicvars.centiseconds;
+  struct timespec tv;
+
+  clock_gettime(basicvars.clocktype, &tv);
+  return ((int64)tv.tv_sec * 100) + (tv.tv_nsec / 10000000);
+}
+
+/*
+** 'mos_microseconds' returns the value of the same clock as
+** 'mos_centiseconds' in microseconds
+*/
+int64 mos_microseconds(void) {
+  struct timespec tv;
+
+  clock_gettime(basicvars.clocktype, &tv);
+  return ((int64)tv.tv_sec * 1000000) + (tv.tv_nsec / 1000);
 }
 
 int32 mos_rdtime(void) {
-  return ((int32) (basicvars.centiseconds - startime));
+  return ((int32) (mos_centiseconds() - startime));
 }
 
 /*
@@ -803,7 +837,7 @@ int32 mos_rdtime(void) {
 ** The effects of 'TIME=' are emulated here
 */
 void mos_wrtime (int32 time) {
-  startime = (basicvars.centiseconds - time);
+  startime = (mos_centiseconds() - time);
 }
 
 #endif
@@ -1121,24 +1155,32 @@ void mos_waitdelay(int32 time) {
 
 #else
 
+#define ESCPOLLTIME 2000	/* Microseconds between checks for Escape in SDL version */
+
 /*
 ** 'mos_waitdelay' emulate the Basic statement 'WAIT <time>'
 ** 'time' is the time to wait in centiseconds.
+** The process sleeps until the time is up. Pressing Escape raises
+** SIGINT, which cuts the sleep short. The SDL version has to look
+** for Escape itself, so it wakes up every couple of milliseconds
+** to do so
 */
 void mos_waitdelay(int32 time) {
-  int64 tbase;
+  int64 deadline, remaining;
+  struct timespec interval;
 
   if (time<=0) return;			/* Nothing to do */
-  tbase=mos_centiseconds();
-  while(mos_centiseconds() < tbase + time) {
+  deadline = mos_microseconds() + (int64)time * 10000;
+  while (!basicvars.escape && (remaining = deadline - mos_microseconds()) > 0) {
 #ifdef USE_SDL
-    if (kbd_escpoll()) {
-      time=0;
-      error(ERR_ESCAPE);
-    }
+    if (kbd_escpoll()) error(ERR_ESCAPE);
+    if (remaining > ESCPOLLTIME) remaining = ESCPOLLTIME;
 #endif /* USE_SDL */
-    usleep(2000);
+    interval.tv_sec = remaining / 1000000;
+    interval.tv_nsec = (remaining % 1000000) * 1000;
+    nanosleep(&interval, NULL);
   }
+  if (kbd_escpoll()) error(ERR_ESCAPE);
 }
 #endif
 #endif
@@ -2029,11 +2071,21 @@ static int check_command(char *text) {
 ** drastically reduced.)
 */
 void mos_oscli(char *command, char *respfile, FILE *respfh) {
+  command = oscli_command(command);
+  if (command != NIL) native_oscli(command, respfile, respfh);
+}
+
+/*
+** 'oscli_command' deals with the commands implemented by the interpreter
+** itself. It returns a pointer to the command to pass to the underlying
+** OS or NIL if there is nothing left to do
+*/
+static char *oscli_command(char *command) {
   int cmd;
 
   while (*command == ' ' || *command == '*') command++;
-  if (*command == 0) return;					/* Null string */
-  if (*command == (char)124 || *command == (char)221) return;	/* Comment     */
+  if (*command == 0) return NIL;				/* Null string */
+  if (*command == (char)124 || *command == (char)221) return NIL;	/* Comment     */
 //if (*command == '\\') { }					/* Extension   */
 
   if (!basicvars.runflags.ignore_starcmd) {
@@ -2043,32 +2095,32 @@ void mos_oscli(char *command, char *respfile, FILE *respfh) {
  */
     cmd = check_command(command);
     switch(cmd){
-      case CMD_KEY:		cmd_key(command+3); return;
-      case CMD_CAT:		cmd_cat(command); return;
-      case CMD_QUIT:		cmd_quit(command+4); return;
-      case CMD_HELP:		cmd_help(command+4); return;
-      case CMD_CD:		cmd_cd(command+2); return;
-      case CMD_FX:		cmd_fx(command+2); return;
-      case CMD_SHOW:		cmd_show(command+4); return;
-      case CMD_EXEC:		cmd_exec(command+4); return;
-      case CMD_SPOOL:		cmd_spool(command+5,0); return;
-      case CMD_SPOOLON:		cmd_spool(command+7,1); return;
-//    case CMD_VER:		cmd_ver(); return;
-      case CMD_SCREENSAVE:	cmd_screensave(command+10); return;
-      case CMD_SCREENLOAD:	cmd_screenload(command+10); return;
-      case CMD_WINTITLE:	cmd_wintitle(command+8); return;
-      case CMD_FULLSCREEN:	cmd_fullscreen(command+10); return;
-      case CMD_NEWMODE:		cmd_newmode(command+7); return;
-      case CMD_REFRESH:		cmd_refresh(command+7); return;
-      case CMD_BRANDYINFO:	cmd_brandyinfo(); return;
-
-      case CMD_LOAD:		cmd_load(command+4); return;
-      case CMD_SAVE:		cmd_save(command+4); return;
-
-      case CMD_VOLUME:		cmd_volume(command+6);return;
-      case CMD_CHANNELVOICE:	cmd_channelvoice(command+12);return;
-      case CMD_VOICES:		cmd_voices();return;
-      case CMD_POINTER:		cmd_pointer(command+7);return;
+      case CMD_KEY:		cmd_key(command+3); return NIL;
+      case CMD_CAT:		cmd_cat(command); return NIL;
+      case CMD_QUIT:		cmd_quit(command+4); return NIL;
+      case CMD_HELP:		cmd_help(command+4); return NIL;
+      case CMD_CD:		cmd_cd(command+2); return NIL;
+      case CMD_FX:		cmd_fx(command+2); return NIL;
+      case CMD_SHOW:		cmd_show(command+4); return NIL;
+      case CMD_EXEC:		cmd_exec(command+4); return NIL;
+      case CMD_SPOOL:		cmd_spool(command+5,0); return NIL;
+      case CMD_SPOOLON:		cmd_spool(command+7,1); return NIL;
+//    case CMD_VER:		cmd_ver(); return NIL;
+      case CMD_SCREENSAVE:	cmd_screensave(command+10); return NIL;
+      case CMD_SCREENLOAD:	cmd_screenload(command+10); return NIL;
+      case CMD_WINTITLE:	cmd_wintitle(command+8); return NIL;
+      case CMD_FULLSCREEN:	cmd_fullscreen(command+10); return NIL;
+      case CMD_NEWMODE:		cmd_newmode(command+7); return NIL;
+      case CMD_REFRESH:		cmd_refresh(command+7); return NIL;
+      case CMD_BRANDYINFO:	cmd_brandyinfo(); return NIL;
+
+      case CMD_LOAD:		cmd_load(command+4); return NIL;
+      case CMD_SAVE:		cmd_save(command+4); return NIL;
+
+      case CMD_VOLUME:		cmd_volume(command+6); return NIL;
+      case CMD_CHANNELVOICE:	cmd_channelvoice(command+12); return NIL;
+      case CMD_VOICES:		cmd_voices(); return NIL;
+      case CMD_POINTER:		cmd_pointer(command+7); return NIL;
     }
   }
 
@@ -2077,7 +2129,7 @@ void mos_oscli(char *command, char *respfile, FILE *respfh) {
     while (*command == ' ') command++;	/* And skip any more leading spaces */
   }
 
-  native_oscli(command, respfile, respfh);
+  return command;
 }
 
 #ifdef TARGET_MINGW
@@ -2155,14 +2207,196 @@ int ReadFromPipe(void) {
 }
 #endif /* TARGET_MINGW */
 
+#ifdef TARGET_UNIX
+#define OSCLIBUFSIZE 65536	/* Size of blocks command output is read in */
+
+/*
+** 'oscli_needshell' returns TRUE if command 'command' has to be run by
+** the shell, that is, it contains anything other than the name of a
+** program and its arguments or it is a command built in to the shell
+*/
+static boolean oscli_needshell(char *command) {
+  static char *builtins[] = {
+    "cd", "exit", "export", "unset", "set", "source", ".", ":", "alias",
+    "unalias", "exec", "eval", "ulimit", "umask", "read", "wait", "trap",
+    "shift", "type", "command", "hash", "times", "readonly", "local",
+    "jobs", "fg", "bg", "if", "for", "while", "until", "case", "!", NULL
+  };
+  char *p;
+  int n, length;
+
+  if (strpbrk(command, "|&;<>()$`\\\"'*?[]#~{}!\n") != NULL) return TRUE;
+  p = command;
+  while (*p == ' ' || *p == '\t') p++;
+  length = strcspn(p, " \t");
+  if (length == 0 || memchr(p, '=', length) != NULL) return TRUE;	/* Setting a variable */
+  for (n=0; builtins[n] != NULL; n++) {
+    if (strlen(builtins[n]) == length && !strncmp(p, builtins[n], length)) return TRUE;
+  }
+  return FALSE;
+}
+
+/*
+** 'oscli_spawn' starts command 'command' as a child process, returning
+** its process ID or -1 if it could not be started. If 'outfd' is not
+** -1, the command's standard output and standard error go to it and
+** 'closefd' (the other end of the pipe) is closed in the child. Commands
+** with no shell syntax in them are run directly, saving the cost of
+** starting a shell to run them
+*/
+static pid_t oscli_spawn(char *command, int outfd, int closefd) {
+  posix_spawn_file_actions_t actions, *ap = NULL;
+  char *argbuf, **argv, *shellargv[4];
+  pid_t pid;
+  int argc, result;
+
+  if (outfd != -1) {
+    ap = &actions;
+    posix_spawn_file_actions_init(ap);
+    posix_spawn_file_actions_addclose(ap, closefd);
+    posix_spawn_file_actions_adddup2(ap, outfd, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(ap, outfd, STDERR_FILENO);
+    posix_spawn_file_actions_addclose(ap, outfd);
+  }
+  result = -1;
+  if (!oscli_needshell(command)) {	/* Split command into words and run it directly */
+    argbuf = strdup(command);
+    argv = malloc((strlen(command)/2+2)*sizeof(char *));
+    if (argbuf != NULL && argv != NULL) {
+      argc = 0;
+      argv[argc] = strtok(argbuf, " \t");
+      while (argv[argc] != NULL) argv[++argc] = strtok(NULL, " \t");
+      result = posix_spawnp(&pid, argv[0], ap, NULL, argv, environ);
+    }
+    free(argv);
+    free(argbuf);
+  }
+  if (result != 0) {	/* Use the shell, which also reports commands that cannot be found */
+    shellargv[0] = "sh";
+    shellargv[1] = "-c";
+    shellargv[2] = command;
+    shellargv[3] = NULL;
+    result = posix_spawn(&pid, "/bin/sh", ap, NULL, shellargv, environ);
+  }
+  if (ap != NULL) posix_spawn_file_actions_destroy(ap);
+  return result == 0 ? pid : -1;
+}
+
+/*
+** 'oscli_wait' waits for child process 'pid' to finish and returns its
+** status in the same form as 'system()'
+*/
+static int oscli_wait(pid_t pid) {
+  int status;
+
+  while (waitpid(pid, &status, 0) == -1) {
+    if (errno != EINTR) return -1;
+  }
+  return status;
+}
+
+/*
+** 'oscli_read' reads the next block of the output of a command from
+** 'fd' into 'buffer', returning the number of bytes read or zero at
+** the end of the output
+*/
+static ssize_t oscli_read(int fd, char *buffer, size_t size) {
+  ssize_t count;
+
+  do
+    count = read(fd, buffer, size);
+  while (count == -1 && errno == EINTR);
+  return count < 0 ? 0 : count;
+}
+
+#ifdef USE_SDL
+/*
+** 'oscli_show' displays a block of command output, adding a carriage
+** return before each linefeed
+*/
+static void oscli_show(char *text, ssize_t count) {
+  char *end = text+count, *lf;
+
+  while (text < end) {
+    lf = memchr(text, '\n', end-text);
+    if (lf == NULL) lf = end;
+    if (lf > text) emulate_vdustr(text, lf-text);
+    if (lf < end) {
+      emulate_vdu('\r');
+      emulate_vdu('\n');
+      lf++;
+    }
+    text = lf;
+  }
+}
+#endif
+#endif /* TARGET_UNIX */
+
+/*
+** 'mos_oscli_capture' runs command 'command' and returns its output in
+** a block of memory allocated with malloc(), setting '*length' to the
+** number of bytes in it. It returns NIL if this cannot be done on this
+** platform, in which case the output has to go via a file instead
+*/
+char *mos_oscli_capture(char *command, int32 *length) {
+#ifdef TARGET_UNIX
+  char *output, *newoutput;
+  size_t size, used;
+  ssize_t count;
+  int pipefd[2];
+  pid_t pid;
+
+  command = oscli_command(command);
+  *length = 0;
+  output = malloc(OSCLIBUFSIZE);
+  if (output == NIL) error(ERR_NOROOM);
+  if (command == NIL) return output;
+  if (pipe(pipefd) == -1) {
+    free(output);
+    error(ERR_CMDFAIL);
+  }
+  pid = oscli_spawn(command, pipefd[1], pipefd[0]);
+  close(pipefd[1]);
+  if (pid == -1) {
+    close(pipefd[0]);
+    free(output);
+    error(ERR_CMDFAIL);
+  }
+  size = OSCLIBUFSIZE;
+  used = 0;
+  while ((count = oscli_read(pipefd[0], output+used, size-used)) > 0) {
+    used+=count;
+    if (used == size) {		/* Buffer full - Make it bigger */
+      newoutput = realloc(output, size*2);
+      if (newoutput == NIL) break;	/* Out of memory - Keep what has been read */
+      output = newoutput;
+      size = size*2;
+    }
+  }
+  close(pipefd[0]);
+  basicvars.retcode = oscli_wait(pid);
+  *length = used > MAXINTVAL ? MAXINTVAL : used;
+  return output;
+#else
+  return NIL;
+#endif
+}
+
 static void native_oscli(char *command, char *respfile, FILE *respfh) {
   int clen;
-  FILE *sout;
   char *cmdbuf, *cmdbufbase, *pipebuf=NULL;
-#ifdef USE_SDL
-#ifndef TARGET_MINGW
-  char buf;
+#ifdef TARGET_AMIGA
+  FILE *sout;
 #endif
+#ifdef TARGET_UNIX
+  int pipefd[2];
+  pid_t pid;
+  ssize_t count;
+#ifndef USE_SDL
+  struct sigaction ignore, oldint, oldquit;
+#endif
+#elif defined(USE_SDL) && !defined(TARGET_MINGW)
+  char buf;
 #endif
 #if defined(TARGET_MINGW) && defined(USE_SDL)
   int getChar;
@@ -2201,7 +2435,69 @@ static void native_oscli(char *command, char *respfile, FILE *respfh) {
     }
   }
 
-#elif defined(TARGET_MACOSX) | defined(TARGET_UNIX) | defined(TARGET_AMIGA)
+#elif defined(TARGET_UNIX)
+/* Command is to be sent to underlying Unix-style OS, excluding MinGW */
+/* This is the Unix version of the function. The command is started with
+** posix_spawn() and its output, including stderr, is read from a pipe in
+** large blocks when it is to be shown in the SDL window or redirected
+*/
+  if (respfile == NIL) {		/* Command output goes to normal place */
+#ifdef USE_SDL
+    if (pipe(pipefd) == -1) error(ERR_CMDFAIL);
+    pid = oscli_spawn(cmdbuf, pipefd[1], pipefd[0]);
+    close(pipefd[1]);
+    if (pid == -1) {
+      close(pipefd[0]);
+      error(ERR_CMDFAIL);
+    }
+    pipebuf=malloc(OSCLIBUFSIZE);
+    while (pipebuf != NULL && (count = oscli_read(pipefd[0], pipebuf, OSCLIBUFSIZE)) > 0) oscli_show(pipebuf, count);
+    close(pipefd[0]);
+    basicvars.retcode = oscli_wait(pid);
+#else
+    fflush(stdout);			/* Make sure everything has been output */
+    fflush(stderr);
+    pid = oscli_spawn(cmdbuf, -1, -1);
+    if (pid == -1) error(ERR_CMDFAIL);
+/* Ignore interrupts while the command runs, as system() does */
+    ignore.sa_handler = SIG_IGN;
+    sigemptyset(&ignore.sa_mask);
+    ignore.sa_flags = 0;
+    sigaction(SIGINT, &ignore, &oldint);
+    sigaction(SIGQUIT, &ignore, &oldquit);
+    basicvars.retcode = oscli_wait(pid);
+    sigaction(SIGINT, &oldint, NULL);
+    sigaction(SIGQUIT, &oldquit, NULL);
+    find_cursor();			/* Figure out where the cursor has gone to */
+    if (basicvars.retcode < 0) error(ERR_CMDFAIL);
+#endif
+  } else {				/* Want response back from command */
+    pid = -1;
+    if (pipe(pipefd) != -1) {
+      pid = oscli_spawn(cmdbuf, pipefd[1], pipefd[0]);
+      close(pipefd[1]);
+      if (pid == -1) close(pipefd[0]);
+    }
+    if (pid == -1) {
+      fclose(respfh);
+      remove(respfile);
+      error(ERR_CMDFAIL);
+    }
+    pipebuf=malloc(OSCLIBUFSIZE);
+#if !defined(USE_SDL)
+    echo_off();
+#endif
+    while (pipebuf != NULL && (count = oscli_read(pipefd[0], pipebuf, OSCLIBUFSIZE)) > 0) fwrite(pipebuf, 1, count, respfh);
+#if !defined(USE_SDL)
+    echo_on();
+#endif
+    close(pipefd[0]);
+    basicvars.retcode = oscli_wait(pid);
+    fclose(respfh);
+  }
+  if (pipebuf) free(pipebuf);
+
+#elif defined(TARGET_AMIGA)
 /* Command is to be sent to underlying Unix-style OS, excluding MinGW */
 /* This is the Unix version of the function, where both stdout
 ** and stderr can be redirected to a file
@@ -27,12 +27,21 @@
 
 #include "common.h"
 
+/* Processor flag bits returned by mos_sys() */
+
+#define OVERFLOW_FLAG 1
+#define CARRY_FLAG 2
+#define ZERO_FLAG 4
+#define NEGATIVE_FLAG 8
+
 extern void  mos_oscli(char *, char *, FILE *);
+extern char *mos_oscli_capture(char *, int32 *);
 extern int32 mos_adval(int32);
 extern void  mos_sound_on(void);
 extern void  mos_sound_off(void);
 extern void  mos_sound(int32, int32, int32, int32, int32);
 extern int64 mos_centiseconds(void);
+extern int64 mos_microseconds(void);
 extern int32 mos_rdtime(void);
 extern void  mos_wrtime(int32);
 extern void  mos_rdrtc(char *);
@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -35,6 +36,10 @@
 #endif /* USE_GNU */
 #include <dlfcn.h>
 #endif /* UNIX || MINGW */
+#ifdef TARGET_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
 #include "common.h"
 #include "errors.h"
 #include "basicdefs.h"
@@ -43,6 +48,7 @@
 #include "screen.h"
 #include "keyboard.h"
 #include "miscprocs.h"
+#include "fileio.h"
 #ifdef USE_SDL
 #include "SDL.h"
 #include "SDL_syswm.h"
@@ -142,6 +148,16 @@ static void *rtrdlsym (void *handle, const char *symbol) {
 }
 #endif
 
+/*
+** 'sysparm_int64' returns the signed value of a SYS parameter. On
+** systems where registers are 32 bits wide, -1 would otherwise come
+** out as &FFFFFFFF
+*/
+static int64 sysparm_int64(size_t value) {
+  if (sizeof(size_t) < sizeof(int64)) return (int32)value;
+  return (int64)value;
+}
+
 #if defined(TARGET_UNIX) || defined(TARGET_MINGW)
 #ifndef __clang__
 #pragma GCC optimize "O0"
@@ -179,13 +195,52 @@ static size_t do_syscall(size_t (*dlsh)(size_t, size_t,size_t,size_t,size_t,
 #endif
 
 #ifndef __clang__
+#define DLCACHESIZE 64		/* Number of chains in symbol address cache */
+
+/*
+** 'dlcacheentry' holds the address of a symbol that has been looked up
+** by 'get_dladdr'. Libraries are never unloaded, so once found the
+** address of a symbol cannot change
+*/
+typedef struct dlcacheentry {
+  void *libhandle;		/* Library the symbol was looked up in */
+  char *name;			/* Name of the symbol */
+  void *address;		/* Address of the symbol */
+  struct dlcacheentry *next;
+} dlcacheentry;
+
+static dlcacheentry *dlcache[DLCACHESIZE];
+
+/*
+** 'dlcache_chain' returns the cache chain for symbol 'name'
+*/
+static dlcacheentry **dlcache_chain(char *name) {
+  uint32 hashvalue = 0;
+  while (*name) {
+    hashvalue = hashvalue*31+(byte)*name;
+    name++;
+  }
+  return &dlcache[hashvalue % DLCACHESIZE];
+}
+
+/*
+** 'get_dladdr' returns the address of the symbol whose name is at
+** 'nameptr' in library 'libhandle', or in any loaded library if
+** 'libhandle' is NULL. Symbols found are remembered so that calling
+** the same function over and over does not look it up each time
+*/
 static void *get_dladdr(size_t nameptr, void *libhandle, int32 xflag) {
   void *dlsh;
+  dlcacheentry **chain, *cp;
 #ifndef TARGET_MINGW
   char *errcond;
 #endif
 
   if (libhandle == NULL) libhandle = RTLD_DEFAULT;
+  chain = dlcache_chain((char *)nameptr);
+  for (cp = *chain; cp != NULL; cp = cp->next) {
+    if (cp->libhandle == libhandle && !strcmp(cp->name, (char *)nameptr)) return cp->address;
+  }
   dlerror(); /* Flush the error state */
 #ifdef TARGET_MINGW
   *(void **)(&dlsh)=rtrdlsym(libhandle, (void *)nameptr);
@@ -201,8 +256,359 @@ static void *get_dladdr(size_t nameptr, void *libhandle, int32 xflag) {
     dlsh = (void *)-1;
   }
 #endif
+  if (dlsh != (void *)-1) {
+    cp = malloc(sizeof(dlcacheentry));
+    if (cp != NULL && (cp->name = strdup((char *)nameptr)) != NULL) {
+      cp->libhandle = libhandle;
+      cp->address = dlsh;
+      cp->next = *chain;
+      *chain = cp;
+    } else {
+      free(cp);
+    }
+  }
   return (dlsh);
 }
+
+/*
+** The following code deals with functions declared with Brandy_dlbind.
+** The signature of the function is given once and the arguments to each
+** call are passed in the registers the function expects them in rather
+** than in all thirty of the integer and floating point slots that
+** Brandy_dlcall fills in. On x86-64 (other than Windows) and AArch64,
+** integer and floating point arguments go in separate sets of registers
+** regardless of the order in which they appear, so a call only depends
+** on how many of each there are. There is a call stub for each number
+** of integer arguments up to six and number of floating point arguments
+** up to eight. Elsewhere, or if there are more arguments than this,
+** the function is called the same way as by Brandy_dlcall
+*/
+#if (defined(__x86_64__) && !defined(_WIN32)) || (defined(__aarch64__) && !defined(__AARCH64EB__))
+#define FFI_STUBS
+#endif
+
+/* Types of value in a function signature */
+#define FFI_VOID 0
+#define FFI_INT8 1
+#define FFI_UINT8 2
+#define FFI_INT16 3
+#define FFI_UINT16 4
+#define FFI_INT32 5
+#define FFI_UINT32 6
+#define FFI_INT64 7
+#define FFI_PTR 8
+#define FFI_FLOAT 9
+#define FFI_DOUBLE 10
+
+#define FFI_MAXINTS 6		/* Most integer arguments that can be passed by a call stub */
+#define FFI_MAXFLOATS 8		/* Most floating point arguments that can be passed by a call stub */
+#define FFI_MAXARGS (MAXSYSPARMS-1)	/* Most arguments of either kind, as R0 holds the handle */
+
+typedef union {
+  int64 i;
+  double f;
+} ffiresult;
+
+typedef void ffistub(void *fn, int64 *a, double *d, boolean isfloat, ffiresult *result);
+
+/*
+** 'ffibinding' holds the details of a function declared with Brandy_dlbind
+*/
+typedef struct {
+  void *address;		/* Address of function */
+  int32 rettype;		/* FFI_xxx type of result */
+  int32 intcount;		/* Number of integer and pointer arguments */
+  int32 floatcount;		/* Number of floating point arguments */
+  uint32 singles;		/* Bit n is set if floating point argument n is a 'float' */
+  int32 argcount;		/* Number of arguments */
+  byte argtypes[2*FFI_MAXARGS];	/* FFI_xxx type of each argument in the order declared */
+  ffistub *stub;		/* Call stub, or NULL to call it as Brandy_dlcall does */
+  double fpresult;		/* Floating point result of last call */
+} ffibinding;
+
+static ffibinding **ffibindings;	/* Table of functions declared, grown as needed */
+static int32 fficount;			/* Number of entries in use in 'ffibindings' */
+
+#ifdef FFI_STUBS
+#define FFI_I1 int64
+#define FFI_I2 FFI_I1, int64
+#define FFI_I3 FFI_I2, int64
+#define FFI_I4 FFI_I3, int64
+#define FFI_I5 FFI_I4, int64
+#define FFI_I6 FFI_I5, int64
+#define FFI_A1 a[0]
+#define FFI_A2 FFI_A1, a[1]
+#define FFI_A3 FFI_A2, a[2]
+#define FFI_A4 FFI_A3, a[3]
+#define FFI_A5 FFI_A4, a[4]
+#define FFI_A6 FFI_A5, a[5]
+#define FFI_F2 double, double
+#define FFI_F4 FFI_F2, double, double
+#define FFI_F8 FFI_F4, double, double, double, double
+#define FFI_D2 d[0], d[1]
+#define FFI_D4 FFI_D2, d[2], d[3]
+#define FFI_D8 FFI_D4, d[4], d[5], d[6], d[7]
+
+/*
+** FFI_STUB defines a call stub that passes the arguments in 'args',
+** whose types are given by 'types'. A function that takes fewer
+** floating point arguments than a stub passes just ignores the rest
+*/
+#define FFI_STUB(name, types, args) \
+static void name(void *fn, int64 *a, double *d, boolean isfloat, ffiresult *result) { \
+  if (isfloat) \
+    result->f = ((double (*)types)fn)args; \
+  else \
+    result->i = ((int64 (*)types)fn)args; \
+}
+
+FFI_STUB(ffi_i0f0, (void), ())
+FFI_STUB(ffi_i0f2, (FFI_F2), (FFI_D2))
+FFI_STUB(ffi_i0f4, (FFI_F4), (FFI_D4))
+FFI_STUB(ffi_i0f8, (FFI_F8), (FFI_D8))
+FFI_STUB(ffi_i1f0, (FFI_I1), (FFI_A1))
+FFI_STUB(ffi_i1f2, (FFI_I1, FFI_F2), (FFI_A1, FFI_D2))
+FFI_STUB(ffi_i1f4, (FFI_I1, FFI_F4), (FFI_A1, FFI_D4))
+FFI_STUB(ffi_i1f8, (FFI_I1, FFI_F8), (FFI_A1, FFI_D8))
+FFI_STUB(ffi_i2f0, (FFI_I2), (FFI_A2))
+FFI_STUB(ffi_i2f2, (FFI_I2, FFI_F2), (FFI_A2, FFI_D2))
+FFI_STUB(ffi_i2f4, (FFI_I2, FFI_F4), (FFI_A2, FFI_D4))
+FFI_STUB(ffi_i2f8, (FFI_I2, FFI_F8), (FFI_A2, FFI_D8))
+FFI_STUB(ffi_i3f0, (FFI_I3), (FFI_A3))
+FFI_STUB(ffi_i3f2, (FFI_I3, FFI_F2), (FFI_A3, FFI_D2))
+FFI_STUB(ffi_i3f4, (FFI_I3, FFI_F4), (FFI_A3, FFI_D4))
+FFI_STUB(ffi_i3f8, (FFI_I3, FFI_F8), (FFI_A3, FFI_D8))
+FFI_STUB(ffi_i4f0, (FFI_I4), (FFI_A4))
+FFI_STUB(ffi_i4f2, (FFI_I4, FFI_F2), (FFI_A4, FFI_D2))
+FFI_STUB(ffi_i4f4, (FFI_I4, FFI_F4), (FFI_A4, FFI_D4))
+FFI_STUB(ffi_i4f8, (FFI_I4, FFI_F8), (FFI_A4, FFI_D8))
+FFI_STUB(ffi_i5f0, (FFI_I5), (FFI_A5))
+FFI_STUB(ffi_i5f2, (FFI_I5, FFI_F2), (FFI_A5, FFI_D2))
+FFI_STUB(ffi_i5f4, (FFI_I5, FFI_F4), (FFI_A5, FFI_D4))
+FFI_STUB(ffi_i5f8, (FFI_I5, FFI_F8), (FFI_A5, FFI_D8))
+FFI_STUB(ffi_i6f0, (FFI_I6), (FFI_A6))
+FFI_STUB(ffi_i6f2, (FFI_I6, FFI_F2), (FFI_A6, FFI_D2))
+FFI_STUB(ffi_i6f4, (FFI_I6, FFI_F4), (FFI_A6, FFI_D4))
+FFI_STUB(ffi_i6f8, (FFI_I6, FFI_F8), (FFI_A6, FFI_D8))
+
+/* Call stubs indexed by number of integer arguments and (number of floating point arguments+1)/2 */
+static ffistub *ffistubs[FFI_MAXINTS+1][5] = {
+  {ffi_i0f0, ffi_i0f2, ffi_i0f4, ffi_i0f8, ffi_i0f8},
+  {ffi_i1f0, ffi_i1f2, ffi_i1f4, ffi_i1f8, ffi_i1f8},
+  {ffi_i2f0, ffi_i2f2, ffi_i2f4, ffi_i2f8, ffi_i2f8},
+  {ffi_i3f0, ffi_i3f2, ffi_i3f4, ffi_i3f8, ffi_i3f8},
+  {ffi_i4f0, ffi_i4f2, ffi_i4f4, ffi_i4f8, ffi_i4f8},
+  {ffi_i5f0, ffi_i5f2, ffi_i5f4, ffi_i5f8, ffi_i5f8},
+  {ffi_i6f0, ffi_i6f2, ffi_i6f4, ffi_i6f8, ffi_i6f8}
+};
+#endif /* FFI_STUBS */
+
+/*
+** 'ffi_type' reads the name of a type at '*pp' in a function signature,
+** moving '*pp' past it. Any name following the type is skipped as well.
+** It returns the FFI_xxx value for the type
+*/
+static int32 ffi_type(char **pp) {
+  static struct {char *name; int32 type;} types[] = {
+    {"void", FFI_VOID}, {"i8", FFI_INT8}, {"u8", FFI_UINT8}, {"char", FFI_INT8},
+    {"i16", FFI_INT16}, {"u16", FFI_UINT16}, {"short", FFI_INT16},
+    {"i32", FFI_INT32}, {"u32", FFI_UINT32}, {"int", FFI_INT32},
+    {"i64", FFI_INT64}, {"u64", FFI_INT64}, {"long", FFI_INT64},
+    {"ptr", FFI_PTR}, {"str", FFI_PTR}, {"f32", FFI_FLOAT}, {"float", FFI_FLOAT},
+    {"f64", FFI_DOUBLE}, {"double", FFI_DOUBLE}, {NULL, 0}
+  };
+  char *p = *pp, *start;
+  int32 n, length, type = -1;
+
+  while (*p == ' ') p++;
+  if (!strncmp(p, "const ", 6)) p+=6;	/* Qualifier makes no difference here */
+  while (*p == ' ') p++;
+  start = p;
+  while (isalnum((byte)*p) || *p == '_') p++;
+  length = p-start;
+  for (n=0; types[n].name != NULL; n++) {
+    if (length == strlen(types[n].name) && !strncmp(start, types[n].name, length)) {
+      type = types[n].type;
+      break;
+    }
+  }
+  while (*p == ' ') p++;
+  if (*p == '*') {		/* Any pointer type */
+    while (*p == '*' || *p == ' ') p++;
+    if (length > 0) type = FFI_PTR;
+  }
+  if (type == -1) error(ERR_DL_BADSIG);
+  while (isalnum((byte)*p) || *p == '_') p++;	/* Skip name of function or argument */
+  while (*p == ' ') p++;
+  *pp = p;
+  return type;
+}
+
+/*
+** 'ffi_bind' creates a binding for the function at 'address' whose
+** signature is given by 'signature', for example "i32 f(ptr, i64, double)",
+** and returns its handle
+*/
+static int32 ffi_bind(char *signature, void *address) {
+  ffibinding *bp, **newtable;
+  int32 type, rettype, intcount, floatcount;
+  uint32 singles;
+  byte argtypes[2*FFI_MAXARGS];
+  ffistub *stub;
+  char *p = signature;
+
+  intcount = floatcount = 0;
+  singles = 0;
+  rettype = ffi_type(&p);
+  if (*p != '(') error(ERR_DL_BADSIG);
+  p++;
+  while (*p == ' ') p++;
+  while (*p != ')') {
+    type = ffi_type(&p);
+    if (type == FFI_VOID) {
+      if (*p == ')' && intcount+floatcount == 0) break;	/* f(void) */
+      error(ERR_DL_BADSIG);
+    }
+    if (intcount+floatcount == 2*FFI_MAXARGS) error(ERR_SYSCOUNT);
+    argtypes[intcount+floatcount] = type;
+    if (type == FFI_FLOAT || type == FFI_DOUBLE) {
+      if (type == FFI_FLOAT) singles |= 1u<<floatcount;
+      floatcount++;
+    } else {
+      intcount++;
+    }
+    if (*p == ',') p++;
+    else if (*p != ')') error(ERR_DL_BADSIG);
+  }
+  if (intcount > FFI_MAXARGS || floatcount > FFI_MAXARGS) error(ERR_SYSCOUNT);
+  stub = NULL;
+#ifdef FFI_STUBS
+  if (intcount <= FFI_MAXINTS && floatcount <= FFI_MAXFLOATS) stub = ffistubs[intcount][(floatcount+1)/2];
+#endif
+/* Without a stub, the function is called as by Brandy_dlcall, which cannot deal with these */
+  if (stub == NULL && (rettype == FFI_FLOAT || rettype == FFI_DOUBLE || singles != 0)) error(ERR_DL_BADSIG);
+  newtable = realloc(ffibindings, (fficount+1)*sizeof(ffibinding *));
+  if (newtable == NULL) error(ERR_NOROOM);
+  ffibindings = newtable;
+  bp = malloc(sizeof(ffibinding));
+  if (bp == NULL) error(ERR_NOROOM);
+  bp->address = address;
+  bp->stub = stub;
+  bp->rettype = rettype;
+  bp->intcount = intcount;
+  bp->floatcount = floatcount;
+  bp->singles = singles;
+  bp->argcount = intcount+floatcount;
+  memcpy(bp->argtypes, argtypes, bp->argcount);
+  bp->fpresult = 0.0;
+  ffibindings[fficount] = bp;
+  fficount++;
+  return fficount;
+}
+
+/*
+** 'ffi_args' copies the arguments for the function described by 'bp'
+** from 'inregs' to 'args', converting each one to the type declared
+** for it, so that 3 can be passed for a 'double' and 2.5 for an 'int'.
+** The SYS statement puts integer and floating point values in separate
+** sequences, starting at inregs[1] and inregs[MAXSYSPARMS+1], and
+** 'basicvars.sysfloats' says which of them each argument is in. The
+** converted arguments are laid out in 'args' in the same way, by the
+** type the function expects. Arguments left out are passed as zero
+*/
+static void ffi_args(ffibinding *bp, sysparm inregs[], sysparm args[]) {
+  int32 n, ip = 1, fp = MAXSYSPARMS+1, ai = 1, af = MAXSYSPARMS+1;
+  boolean isfloat;
+  float64 fvalue = 0.0;
+  int64 ivalue = 0;
+
+  for (n=0; n<MAXSYSPARMS; n++) {
+    args[n].i = 0;
+    args[MAXSYSPARMS+n].f = 0.0;
+  }
+  args[0] = inregs[0];
+  for (n=0; n<bp->argcount; n++) {
+    isfloat = (basicvars.sysfloats & (1u<<(n+1))) != 0;
+    if (isfloat)
+      fvalue = inregs[fp++].f;
+    else
+      ivalue = sysparm_int64(inregs[ip++].i);
+    if (bp->argtypes[n] == FFI_FLOAT || bp->argtypes[n] == FFI_DOUBLE)
+      args[af++].f = isfloat ? fvalue : (float64)ivalue;
+    else
+      args[ai++].i = isfloat ? TOINT64(fvalue) : ivalue;
+  }
+}
+
+/*
+** 'ffi_call' calls the function with handle 'handle' returned by
+** 'ffi_bind'. The arguments are first converted to the types in the
+** function's signature by 'ffi_args'. R0 returns the result if it is
+** an integer or pointer. R1 returns the address of the result as an
+** eight-byte floating point value if it is a 'float' or 'double'
+*/
+static void ffi_call(int32 handle, sysparm inregs[], size_t outregs[]) {
+  ffibinding *bp;
+  ffiresult result;
+  int64 value;
+  sysparm args[MAXSYSPARMS*2];
+#ifdef FFI_STUBS
+  int64 a[FFI_MAXINTS];
+  double d[FFI_MAXFLOATS];
+  int32 n;
+  float single;
+  uint64 bits;
+#endif
+
+  if (handle < 1 || handle > fficount) error(ERR_DL_BADSIG);
+  bp = ffibindings[handle-1];
+  ffi_args(bp, inregs, args);
+  if (bp->stub == NULL) {
+    outregs[0] = do_syscall((size_t (*)(size_t, size_t,size_t,size_t,size_t,size_t,size_t,size_t,
+                        size_t,size_t,size_t,size_t,size_t,size_t,size_t))bp->address, args);
+    result.i = outregs[0];
+  } else {
+#ifdef FFI_STUBS
+    for (n=0; n<bp->intcount; n++) a[n] = args[1+n].i;
+    for (n=0; n<bp->floatcount; n++) {
+      d[n] = args[MAXSYSPARMS+1+n].f;
+      if (bp->singles & (1u<<n)) {
+/*
+** A 'float' goes in the low-order 32 bits of the register that would
+** hold a 'double', with both ABIs call stubs are used with
+*/
+        single = d[n];
+        bits = 0;
+        memcpy(&bits, &single, sizeof(single));
+        memcpy(&d[n], &bits, sizeof(bits));
+      }
+    }
+    for (n=bp->floatcount; n<FFI_MAXFLOATS; n++) d[n] = 0.0;
+    (*bp->stub)(bp->address, a, d, bp->rettype == FFI_FLOAT || bp->rettype == FFI_DOUBLE, &result);
+    if (bp->rettype == FFI_FLOAT) {
+      memcpy(&bits, &result.f, sizeof(bits));
+      memcpy(&single, &bits, sizeof(single));
+      result.f = single;
+    }
+#endif
+  }
+  switch (bp->rettype) {
+  case FFI_VOID:	value = 0; break;
+  case FFI_INT8:	value = (signed char)result.i; break;
+  case FFI_UINT8:	value = (uint8)result.i; break;
+  case FFI_INT16:	value = (short)result.i; break;
+  case FFI_UINT16:	value = (unsigned short)result.i; break;
+  case FFI_INT32:	value = (int32)result.i; break;
+  case FFI_UINT32:	value = (uint32)result.i; break;
+  case FFI_FLOAT: case FFI_DOUBLE:
+    bp->fpresult = result.f;
+    outregs[1] = (size_t)&bp->fpresult;
+    value = 0;
+    break;
+  default:		value = result.i;
+  }
+  outregs[0] = value;
+}
 #endif /* __clang__ */
 #endif /* TARGET_UNIX | TARGET_MINGW */
 
@@ -222,11 +628,52 @@ static uint32 rpi2gpio(uint32 newtype) {
   return (rpiboards[ptr].boardtype);
 }
 
+/*
+** 'check_sysarray' raises an error if SYS parameter 'reg' was an array
+** and 'count' items of 'size' bytes each would not fit in it. Addresses
+** given as plain numbers cannot be checked
+*/
+static void check_sysarray(int32 reg, int32 count, size_t size) {
+  if (count < 0) error(ERR_RANGE);
+  if (basicvars.sysarrays[reg] != 0 && (size_t)count > basicvars.sysarrays[reg]/size) error(ERR_RANGE);
+}
+
+/*
+** 'mos_gpio' returns TRUE if the Raspberry Pi GPIO interface can be
+** used. '/dev/gpiomem' is mapped into memory the first time it is
+** called rather than when the interpreter starts, as most programs
+** never use it
+*/
+boolean mos_gpio(void) {
+#ifdef TARGET_UNIX
+  static boolean probed = FALSE;
+  byte *gpiomem;
+  int fd;
+
+  if (probed) return matrixflags.gpio;
+  probed = TRUE;
+  fd=open("/dev/gpiomem", O_RDWR | O_SYNC);
+  if (fd == -1) return FALSE;			/* Couldn't open /dev/gpiomem - exit quietly */
+
+  gpiomem=(byte *)mmap(NULL, 0x1000, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (gpiomem == MAP_FAILED) {
+    matrixflags.gpiomem = NULL;
+    return FALSE;
+  }
+  /* If we got here, mmap succeeded. */
+  matrixflags.gpio = 1;
+  matrixflags.gpiomem = gpiomem;
+  matrixflags.gpiomemint=(uint32 *)matrixflags.gpiomem;
+#endif
+  return matrixflags.gpio;
+}
+
 /* This function handles the SYS calls for the Raspberry Pi GPIO.
 ** This implementation is local to Brandy.
 */
 static void mos_rpi_gpio_sys(size_t swino, sysparm inregs[], size_t outregs[], int32 xflag) {
-  if (!matrixflags.gpio) {
+  if (!mos_gpio()) {
     if (!xflag) error(ERR_NO_RPI_GPIO);
     return;
   }
@@ -266,6 +713,7 @@ static void mos_rpi_gpio_sys(size_t swino, sysparm inregs[], size_t outregs[], i
 /* This is the handler for almost all SYS calls on non-RISC OS platforms.
 ** OS_CLI, OS_Byte, OS_Word and OS_SWINumberFromString are in mos.c
 */
+
 void mos_sys_ext(size_t swino, sysparm inregs[], size_t outregs[], int32 xflag, size_t *flags) {
 #ifndef TARGET_RISCOS
   int32 a, b;
@@ -278,7 +726,6 @@ void mos_sys_ext(size_t swino, sysparm inregs[], size_t outregs[], int32 xflag,
   SDL_SysWMinfo wmInfo;
 #endif
 
-  memset(outstring,0,65536); /* Clear the output string buffer */
   if ((swino >= 256) && (swino <= 511)) { /* Handle the OS_WriteI block */
     inregs[0].i=swino-256;
     swino=SWI_OS_WriteC;
@@ -389,6 +836,24 @@ void mos_sys_ext(size_t swino, sysparm inregs[], size_t outregs[], int32 xflag,
         default: error(ERR_BAD_OSFILE);
       }
       break;
+    case SWI_OS_GBPB:
+/* R1=file handle, R2=address, R3=byte count, R4=file pointer for 1 and 3 */
+      outregs[0]=inregs[0].i;outregs[1]=inregs[1].i;
+      if (inregs[0].i < 1 || inregs[0].i > 4) error(ERR_UNSUPPORTED);
+      if ((int32)inregs[3].i < 0 || inregs[3].i != (uint32)inregs[3].i) error(ERR_RANGE);
+      check_sysarray(2, inregs[3].i, sizeof(byte));
+      if (inregs[0].i == 1 || inregs[0].i == 3) fileio_setptr(inregs[1].i, inregs[4].i);
+      if (inregs[0].i <= 2) {
+        fileio_bputstr(inregs[1].i, (char *)(size_t)inregs[2].i, inregs[3].i);
+        a=inregs[3].i;
+      } else {
+        a=fileio_getblock(inregs[1].i, (byte *)(size_t)inregs[2].i, inregs[3].i);
+        if (a < (int32)inregs[3].i) *flags = CARRY_FLAG;	/* Not everything was read */
+      }
+      outregs[2]=inregs[2].i+a;
+      outregs[3]=inregs[3].i-a;
+      outregs[4]=fileio_getptr(inregs[1].i);
+      break;
     case SWI_OS_ReadLine:
 // RISC OS method is to tweek entry parameters then drop into ReadLine32
 // R0=b31-b28=flags, b27-b0=address
@@ -586,6 +1051,110 @@ void mos_sys_ext(size_t swino, sysparm inregs[], size_t outregs[], int32 xflag,
     case SWI_Brandy_Hex64:
         matrixflags.hex64 = inregs[0].i;
         break;
+    case SWI_Brandy_FastFormat:
+        matrixflags.fastformat = inregs[0].i;
+        break;
+    case SWI_Brandy_MapInput:
+        matrixflags.mapinput = inregs[0].i;
+        break;
+    case SWI_Brandy_NetWait:
+/* R0=address of handle array, R1=address of event array, R2=count, R3=timeout in centiseconds */
+        check_sysarray(0, inregs[2].i, sizeof(int32));
+        check_sysarray(1, inregs[2].i, sizeof(int32));
+        outregs[0]=fileio_wait((int32 *)(size_t)inregs[0].i, (int32 *)(size_t)inregs[1].i, inregs[2].i, inregs[3].i);
+        break;
+    case SWI_Brandy_NetAccept:
+/* R0=handle of listening socket. Returns R0=handle of new connection or 0 */
+        outregs[0]=fileio_accept(inregs[0].i);
+        break;
+    case SWI_Brandy_NetControl:
+/* R0=handle, R1=reason (0=flush, 1=buffering, 2=TCP_NODELAY, 3=TCP_CORK), R2=setting */
+        fileio_netcontrol(inregs[0].i, inregs[1].i, inregs[2].i);
+        break;
+    case SWI_Brandy_AsyncConnect:
+        matrixflags.asyncconnect = inregs[0].i;
+        break;
+    case SWI_Brandy_NetStatus: {
+/* R0=handle. Returns R0=state (0=connected, 1=looking up host, 2=connecting, -1=failed), R1=error number */
+        int32 errnum;
+        outregs[0]=fileio_netstatus(inregs[0].i, &errnum);
+        outregs[1]=errnum;
+        break;
+      }
+    case SWI_Brandy_NetSendBatch: {
+/* R0=handle, R1=address of datagrams stored one after the other, R2=address of length array, R3=count. Returns R0=number sent */
+        int32 *lengths = (int32 *)(size_t)inregs[2].i;
+        size_t total = 0;
+        int32 n;
+        check_sysarray(2, inregs[3].i, sizeof(int32));
+        if (basicvars.sysarrays[1] != 0) {
+          for (n=0; n<inregs[3].i; n++) {
+            if (lengths[n] < 0) error(ERR_RANGE);
+            total += lengths[n];
+          }
+          if (total > basicvars.sysarrays[1]) error(ERR_RANGE);
+        }
+        outregs[0]=fileio_sendbatch(inregs[0].i, (char *)(size_t)inregs[1].i, lengths, inregs[3].i);
+        break;
+      }
+    case SWI_Brandy_NetRecvBatch:
+/* R0=handle, R1=buffer address, R2=space for each datagram, R3=address of length array, R4=maximum count. Returns R0=number received */
+        if (inregs[2].i < 0) error(ERR_RANGE);
+        check_sysarray(3, inregs[4].i, sizeof(int32));
+        if (inregs[2].i > 0) check_sysarray(1, inregs[4].i, inregs[2].i);
+        outregs[0]=fileio_recvbatch(inregs[0].i, (char *)(size_t)inregs[1].i, inregs[2].i, (int32 *)(size_t)inregs[3].i, inregs[4].i);
+        break;
+    case SWI_Brandy_dlbind:
+/* R0=signature, R1=symbol name or 0, R2=library handle or 0 for any, R3=address if R1 is 0. Returns R0=handle */
+#ifdef __clang__
+      error(ERR_DL_NODL);
+#else
+#if defined(TARGET_UNIX) || defined(TARGET_MINGW)
+      {
+        void *address = (void *)(size_t)inregs[3].i;
+        if (inregs[1].i != 0) address = get_dladdr(inregs[1].i, (void *)(size_t)inregs[2].i, xflag);
+        outregs[0] = address == (void *)-1 ? 0 : ffi_bind((char *)(size_t)inregs[0].i, address);
+      }
+#else
+      if (!xflag) error(ERR_DL_NODL);
+      outregs[0]=0;
+#endif /* TARGET_UNIX | TARGET_MINGW */
+#endif /* __clang__ */
+      break;
+    case SWI_Brandy_dlinvoke:
+/* R0=handle from Brandy_dlbind, R1 onwards=arguments. Returns R0=result, R1=address of floating point result */
+#ifdef __clang__
+      error(ERR_DL_NODL);
+#else
+#if defined(TARGET_UNIX) || defined(TARGET_MINGW)
+      ffi_call(inregs[0].i, inregs, outregs);
+#else
+      if (!xflag) error(ERR_DL_NODL);
+      outregs[0]=0;
+#endif /* TARGET_UNIX | TARGET_MINGW */
+#endif /* __clang__ */
+      break;
+    case SWI_Brandy_ReadMicroTime: {
+/* Returns R0=microseconds since the interpreter started, R1=top 32 bits of this */
+      int64 microtime = mos_microseconds() - basicvars.monotonictimebase * 10000;
+      outregs[0] = (size_t)microtime;
+      outregs[1] = (size_t)((uint64)microtime >> 32);
+      break;
+    }
+    case SWI_Brandy_NetSendFile: {
+/* R0=network handle, R1=file handle, R2=offset in file (-1=PTR#), R3=count (-1=to end). Returns R0=bytes sent, R1=status */
+        int64 done;
+        outregs[1]=fileio_sendfile(inregs[0].i, inregs[1].i, sysparm_int64(inregs[2].i), sysparm_int64(inregs[3].i), &done);
+        outregs[0]=done;
+        break;
+      }
+    case SWI_Brandy_NetRecvFile: {
+/* R0=network handle, R1=file handle, R2=count (-1=until closed). Returns R0=bytes written, R1=status */
+        int64 done;
+        outregs[1]=fileio_recvfile(inregs[0].i, inregs[1].i, sysparm_int64(inregs[2].i), &done);
+        outregs[0]=done;
+        break;
+      }
     case SWI_Brandy_DELisBS:
         matrixflags.delcandelete = inregs[0].i;
       break;
@@ -717,7 +1286,7 @@ void mos_sys_ext(size_t swino, sysparm inregs[], size_t outregs[], int32 xflag,
 #endif /* __clang__ */
       break;
     case SWI_RaspberryPi_GPIOInfo:
-      outregs[0]=matrixflags.gpio; outregs[1]=(size_t)matrixflags.gpiomem;
+      outregs[0]=mos_gpio(); outregs[1]=(size_t)matrixflags.gpiomem;
       break;
     case SWI_GPIO_GetBoard:
       file_handle=fopen("/proc/device-tree/model","r");
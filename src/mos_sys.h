@@ -27,6 +27,7 @@
 #define MOS_SWINUMS_H
 
 extern void mos_sys_ext(size_t swino, sysparm inregs[], size_t outregs[], int32 xflag, size_t *flags);
+extern boolean mos_gpio(void);
 
 typedef struct {
   size_t swinum;    /* RISC OS SWI number */
@@ -45,6 +46,7 @@ typedef struct {
 #define SWI_OS_Byte                           0x06
 #define SWI_OS_Word                           0x07
 #define SWI_OS_File                           0x08
+#define SWI_OS_GBPB                           0x0C
 #define SWI_OS_ReadLine                       0x0E
 #define SWI_OS_GetEnv                         0x10
 #define SWI_OS_UpdateMEMC                     0x1A
@@ -125,6 +127,20 @@ typedef struct {
 #define SWI_Brandy_MouseEventExpire           0x140013
 #define SWI_Brandy_dlgetaddr                  0x140014
 #define SWI_Brandy_dlcalladdr                 0x140015
+#define SWI_Brandy_FastFormat                 0x140016
+#define SWI_Brandy_MapInput                   0x140017
+#define SWI_Brandy_NetWait                    0x140018
+#define SWI_Brandy_NetAccept                  0x140019
+#define SWI_Brandy_NetControl                 0x14001A
+#define SWI_Brandy_AsyncConnect               0x14001B
+#define SWI_Brandy_NetStatus                  0x14001C
+#define SWI_Brandy_NetSendBatch               0x14001D
+#define SWI_Brandy_NetRecvBatch               0x14001E
+#define SWI_Brandy_NetSendFile                0x14001F
+#define SWI_Brandy_NetRecvFile                0x140020
+#define SWI_Brandy_dlbind                     0x140021
+#define SWI_Brandy_dlinvoke                   0x140022
+#define SWI_Brandy_ReadMicroTime              0x140023
 
 #define SWI_RaspberryPi_GPIOInfo                  0x140100
 #define SWI_RaspberryPi_GetGPIOPortMode           0x140101
@@ -143,6 +159,7 @@ static switable swilist[] = {
   {SWI_OS_Byte,                               "OS_Byte"},
   {SWI_OS_Word,                               "OS_Word"},
   {SWI_OS_File,                               "OS_File"},
+  {SWI_OS_GBPB,                               "OS_GBPB"},
   {SWI_OS_ReadLine,                           "OS_ReadLine"},
   {SWI_OS_GetEnv,                             "OS_GetEnv"},
   {SWI_OS_UpdateMEMC,                         "OS_UpdateMEMC"}, /* Recognised, does nothing */
@@ -220,6 +237,20 @@ static switable swilist[] = {
   {SWI_Brandy_MouseEventExpire,               "Brandy_MouseEventExpire"},
   {SWI_Brandy_dlgetaddr,                      "Brandy_dlgetaddr"},
   {SWI_Brandy_dlcalladdr,                     "Brandy_dlcalladdr"},
+  {SWI_Brandy_FastFormat,                     "Brandy_FastFormat"},
+  {SWI_Brandy_MapInput,                       "Brandy_MapInput"},
+  {SWI_Brandy_NetWait,                        "Brandy_NetWait"},
+  {SWI_Brandy_NetAccept,                      "Brandy_NetAccept"},
+  {SWI_Brandy_NetControl,                     "Brandy_NetControl"},
+  {SWI_Brandy_AsyncConnect,                   "Brandy_AsyncConnect"},
+  {SWI_Brandy_NetStatus,                      "Brandy_NetStatus"},
+  {SWI_Brandy_NetSendBatch,                   "Brandy_NetSendBatch"},
+  {SWI_Brandy_NetRecvBatch,                   "Brandy_NetRecvBatch"},
+  {SWI_Brandy_NetSendFile,                    "Brandy_NetSendFile"},
+  {SWI_Brandy_NetRecvFile,                    "Brandy_NetRecvFile"},
+  {SWI_Brandy_dlbind,                         "Brandy_dlbind"},
+  {SWI_Brandy_dlinvoke,                       "Brandy_dlinvoke"},
+  {SWI_Brandy_ReadMicroTime,                  "Brandy_ReadMicroTime"},
 
   {SWI_RaspberryPi_GPIOInfo,                  "RaspberryPi_GPIOInfo"},
   {SWI_RaspberryPi_GetGPIOPortMode,           "RaspberryPi_GetGPIOPortMode"},
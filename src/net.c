@@ -17,6 +17,9 @@
 ** the Free Software Foundation, 59 Temple Place - Suite 330,
 ** Boston, MA 02111-1307, USA.
 */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE		/* For sendmmsg() and recvmmsg() */
+#endif
 #include "target.h"
 #ifndef NONET /* matching endif at end of file */
 #include <stdio.h>
@@ -37,6 +40,15 @@
 #endif
 #include <sys/types.h>
 #include <errno.h>
+#ifdef TARGET_LINUX
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#endif
+#ifdef TARGET_UNIX
+#include <poll.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#endif
 #ifdef TARGET_RISCOS
 #include <ctype.h>
 #include "kernel.h"
@@ -45,10 +57,45 @@
 
 #include "basicdefs.h"
 #include "errors.h"
+#include "mos.h"
 #include "net.h"
 
 #define MAXNETRCVLEN 65536
-#define MAXNETSOCKETS 4
+#define MAXNETSENDLEN 16384	/* Size of buffer in which output is collected before sending */
+#define NETSOCKETCHUNK 4	/* Initial size of socket table */
+#define MAXNETEVENTS 64		/* Number of events collected by each call to epoll_wait() */
+#define NETWAKEUP 0xFFFFFFFFu	/* epoll data value that identifies the look-up wake-up pipe */
+#define NETBATCH 64		/* Number of datagrams passed to each sendmmsg() or recvmmsg() call */
+#define MAXNETXFER 0x40000000	/* Most bytes passed to each sendfile() call */
+#define NETPOLLTIME 100		/* Milliseconds between checks for Escape while waiting on a socket */
+
+/* States an entry in the socket table can be in */
+#define NETSTATE_FREE 0		/* Entry is not in use */
+#define NETSTATE_RESOLVING 1	/* Waiting for host name to be looked up */
+#define NETSTATE_CONNECTING 2	/* Waiting for connection to be made */
+#define NETSTATE_OPEN 3		/* Connected or listening */
+#define NETSTATE_FAILED 4	/* Connection could not be made */
+
+/* Kinds of UDP socket */
+#define NETDGRAM_NONE 0		/* Not a UDP socket */
+#define NETDGRAM_CONNECTED 1	/* Sends to and receives from one address */
+#define NETDGRAM_BOUND 2	/* Receives from anywhere and replies to the last sender */
+
+#ifdef TARGET_UNIX
+/*
+** 'netlookup' holds a host name look-up being carried out by a
+** helper thread for a connection opened without waiting
+*/
+typedef struct {
+  char *host;			/* Host name. Port name follows it in the same block */
+  char *port;
+  struct addrinfo hints;
+  struct addrinfo *result;	/* Addresses found */
+  int status;			/* Value returned by getaddrinfo() */
+  int done;			/* Look-up has finished */
+  int abandoned;		/* Connection was closed before the look-up finished */
+} netlookup;
+#endif
 
 #ifdef TARGET_RISCOS
 #ifdef __TARGET_SCL__
@@ -56,13 +103,47 @@ extern int close(int);
 #endif
 #endif
 
-#ifndef NONET
-static int netsockets[MAXNETSOCKETS];
-static char netbuffer[MAXNETSOCKETS][MAXNETRCVLEN + 1];
-static int bufptr[MAXNETSOCKETS];
-static int bufendptr[MAXNETSOCKETS];
-#endif /* NONET */
-static int neteof[MAXNETSOCKETS];
+/*
+** 'netsocket' holds the details of one open socket. The receive buffer
+** is only allocated when something is first read from the socket
+*/
+typedef struct {
+  int state;		/* NETSTATE_xxx value */
+  int socket;		/* Socket descriptor, or -1 if there is not one yet */
+  char *buffer;		/* Receive buffer */
+  int bufptr;		/* Offset of next byte to return from buffer */
+  int bufendptr;	/* Offset of end of data in buffer */
+  int eof;		/* Remote host has closed connection */
+  int ready;		/* NET_READABLE and NET_WRITABLE bits last reported by epoll */
+  char *sendbuf;	/* Output waiting to be sent, allocated when first needed */
+  int sendlen;		/* Number of bytes in 'sendbuf' */
+  int buffered;		/* Output is collected in 'sendbuf' rather than sent straight away */
+  int errnum;		/* Error that stopped connection being made */
+  struct addrinfo *addrs;	/* Addresses to try for a connection being made */
+  struct addrinfo *nextaddr;	/* Next of these to try */
+#ifdef TARGET_UNIX
+  netlookup *lookup;	/* Host name look-up in progress */
+#endif
+  int datagram;		/* NETDGRAM_xxx value */
+#ifndef TARGET_RISCOS
+  struct sockaddr_storage peer;	/* Sender of last datagram received on a bound UDP socket */
+  socklen_t peerlen;	/* Size of 'peer' or 0 if nothing has been received */
+#endif
+} netsocket;
+
+static netsocket *netsockets;	/* Table of sockets, grown as needed */
+static int netcount;		/* Number of entries in 'netsockets' */
+static int netunsent;		/* Set if any socket may have output waiting to be sent */
+#ifdef TARGET_LINUX
+static int netepoll = -1;	/* epoll instance all sockets are registered with */
+#endif
+#ifdef TARGET_UNIX
+static pthread_mutex_t netlookuplock = PTHREAD_MUTEX_INITIALIZER;	/* Guards 'done' and 'abandoned' in look-ups */
+static int netwakeup[2] = {-1, -1};	/* Pipe written to by look-up threads when they finish */
+#endif
+#ifdef TARGET_LINUX
+static int netsplice[2] = {-1, -1};	/* Pipe through which 'net_recvfile' moves data */
+#endif
 
 #ifdef __TARGET_SCL__
 /* SharedCLibrary is missing inet_aton(). Here'a an implementation */
@@ -127,7 +208,6 @@ in_addr_t inet_aton(const char *cp, struct in_addr *addr) {
 
 /* This function only called on startup, cleans the buffer and socket stores */
 void brandynet_init() {
-  int n;
 #ifdef TARGET_MINGW
   WSADATA wsaData;
 #endif
@@ -138,10 +218,8 @@ void brandynet_init() {
 #endif
 
   matrixflags.networking = 1;
-  for (n=0; n<MAXNETSOCKETS; n++) {
-    netsockets[n]=bufptr[n]=bufendptr[n]=neteof[n]=0;
-    memset(netbuffer, 0, (MAXNETSOCKETS * (MAXNETRCVLEN+1)));
-  }
+  netsockets = NIL;
+  netcount = 0;
 #ifdef TARGET_MINGW
   if(WSAStartup(MAKEWORD(2,2), &wsaData)) matrixflags.networking=0;
 #endif
@@ -162,6 +240,307 @@ void brandynet_init() {
 #endif
 }
 
+/*
+** 'find_netslot' returns the index of a free entry in the socket
+** table, making the table bigger if there are none
+*/
+static int find_netslot(void) {
+  int n, newcount;
+  netsocket *newtable;
+
+  for (n=0; n<netcount; n++) {
+    if (netsockets[n].state == NETSTATE_FREE) return(n);
+  }
+  newcount = netcount==0 ? NETSOCKETCHUNK : netcount*2;
+  newtable = realloc(netsockets, newcount*sizeof(netsocket));
+  if (newtable == NIL) {
+    error(ERR_NET_MAXSOCKETS);
+    return(-1);
+  }
+  netsockets = newtable;
+  for (n=netcount; n<newcount; n++) {
+    netsockets[n].state = NETSTATE_FREE;
+    netsockets[n].socket = -1;
+    netsockets[n].buffer = NIL;
+    netsockets[n].sendbuf = NIL;
+  }
+  n = netcount;
+  netcount = newcount;
+  return(n);
+}
+
+/*
+** 'init_netslot' marks entry 'n' of the socket table as in use and
+** puts it in state 'state'
+*/
+static void init_netslot(int n, int state) {
+  netsockets[n].state = state;
+  netsockets[n].socket = -1;
+  netsockets[n].bufptr = netsockets[n].bufendptr = 0;
+  netsockets[n].eof = 0;
+  netsockets[n].ready = 0;
+  netsockets[n].sendlen = 0;
+  netsockets[n].buffered = 1;
+  netsockets[n].errnum = 0;
+  netsockets[n].addrs = netsockets[n].nextaddr = NIL;
+#ifdef TARGET_UNIX
+  netsockets[n].lookup = NIL;
+#endif
+  netsockets[n].datagram = NETDGRAM_NONE;
+#ifndef TARGET_RISCOS
+  netsockets[n].peerlen = 0;
+#endif
+}
+
+/*
+** 'watch_socket' attaches socket 'mysocket' to entry 'n' of the socket
+** table. On Linux, the socket is added to the epoll set so that
+** 'net_wait' can tell when it is ready. It is registered edge-triggered:
+** the 'ready' bits are cleared again when a read or write on the socket
+** finds that it would block
+*/
+static void watch_socket(int n, int mysocket) {
+#ifdef TARGET_LINUX
+  struct epoll_event event;
+#endif
+  netsockets[n].socket = mysocket;
+  netsockets[n].ready = 0;
+#ifdef TARGET_LINUX
+  if (netepoll == -1) netepoll = epoll_create1(EPOLL_CLOEXEC);
+  if (netepoll != -1) {
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.u32 = n;
+    epoll_ctl(netepoll, EPOLL_CTL_ADD, mysocket, &event);
+  }
+#endif
+}
+
+/*
+** 'unwatch_socket' closes the socket attached to entry 'n' of the
+** socket table
+*/
+static void unwatch_socket(int n) {
+  if (netsockets[n].socket == -1) return;
+#ifdef TARGET_LINUX
+  if (netepoll != -1) epoll_ctl(netepoll, EPOLL_CTL_DEL, netsockets[n].socket, NIL);
+#endif
+  close(netsockets[n].socket);
+  netsockets[n].socket = -1;
+}
+
+/*
+** 'claim_netslot' fills in entry 'n' of the socket table for the
+** newly-opened and connected socket 'mysocket'
+*/
+static void claim_netslot(int n, int mysocket) {
+  init_netslot(n, NETSTATE_OPEN);
+  watch_socket(n, mysocket);
+}
+
+#ifdef TARGET_UNIX
+/*
+** The functions that follow deal with connections opened without
+** waiting, as asked for by SYS "Brandy_AsyncConnect". The host name is
+** looked up by a helper thread, as getaddrinfo() can take seconds and
+** cannot be interrupted. The thread writes a byte to the pipe
+** 'netwakeup' when it has finished, which wakes up 'net_wait'. The
+** connection is then started with a non-blocking connect(), and the
+** socket becomes writable when it has been made (or has failed)
+*/
+
+/*
+** 'free_lookup' gets rid of a finished look-up
+*/
+static void free_lookup(netlookup *lp) {
+  if (lp->result != NIL) freeaddrinfo(lp->result);
+  free(lp->host);
+  free(lp);
+}
+
+/*
+** 'lookup_thread' is the function run by the helper thread
+*/
+static void *lookup_thread(void *arg) {
+  netlookup *lp = arg;
+  int status;
+  char ch = 0;
+
+  status = getaddrinfo(lp->host, lp->port, &lp->hints, &lp->result);
+  pthread_mutex_lock(&netlookuplock);
+  lp->status = status;
+  lp->done = 1;
+  if (lp->abandoned)
+    free_lookup(lp);
+  else {
+    if (write(netwakeup[1], &ch, 1) < 0) {
+      /* Pipe is full, so 'net_wait' will wake up anyway */
+    }
+  }
+  pthread_mutex_unlock(&netlookuplock);
+  return(NULL);
+}
+
+/*
+** 'net_wakeup_init' creates the pipe used by look-up threads to say
+** they have finished. The read end is added to the epoll set
+*/
+static void net_wakeup_init(void) {
+#ifdef TARGET_LINUX
+  struct epoll_event event;
+#endif
+  if (netwakeup[0] != -1) return;
+  if (pipe(netwakeup) == -1) error(ERR_NET_NOTSUPP);
+  fcntl(netwakeup[0], F_SETFL, O_NONBLOCK);
+  fcntl(netwakeup[1], F_SETFL, O_NONBLOCK);
+  fcntl(netwakeup[0], F_SETFD, FD_CLOEXEC);
+  fcntl(netwakeup[1], F_SETFD, FD_CLOEXEC);
+#ifdef TARGET_LINUX
+  if (netepoll == -1) netepoll = epoll_create1(EPOLL_CLOEXEC);
+  if (netepoll != -1) {
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u32 = NETWAKEUP;
+    epoll_ctl(netepoll, EPOLL_CTL_ADD, netwakeup[0], &event);
+  }
+#endif
+}
+
+/*
+** 'start_lookup' starts a helper thread looking up the address of
+** 'host'. 'host' is a block obtained by strdup() that also holds the
+** port name and is freed when the look-up is done with
+*/
+static void start_lookup(int n, char *host, char *port, struct addrinfo *hints) {
+  netlookup *lp;
+  pthread_t thread;
+  pthread_attr_t attr;
+
+  net_wakeup_init();
+  lp = malloc(sizeof(netlookup));
+  if (lp == NIL) {
+    free(host);
+    error(ERR_NOROOM);
+  }
+  lp->host = host;
+  lp->port = port;
+  lp->hints = *hints;
+  lp->result = NIL;
+  lp->status = 0;
+  lp->done = lp->abandoned = 0;
+  init_netslot(n, NETSTATE_RESOLVING);
+  netsockets[n].lookup = lp;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  if (pthread_create(&thread, &attr, lookup_thread, lp) != 0) lookup_thread(lp);	/* Do it now instead */
+  pthread_attr_destroy(&attr);
+}
+
+/*
+** 'net_failed' records that the connection for entry 'n' of the socket
+** table could not be made because of error 'errnum'
+*/
+static void net_failed(int n, int errnum) {
+  netsocket *sp = &netsockets[n];
+  if (sp->addrs != NIL) freeaddrinfo(sp->addrs);
+  sp->addrs = sp->nextaddr = NIL;
+  sp->state = NETSTATE_FAILED;
+  sp->errnum = errnum;
+}
+
+/*
+** 'start_connect' starts a non-blocking connection to the next address
+** in the list for entry 'n' in the socket table
+*/
+static void start_connect(int n) {
+  netsocket *sp = &netsockets[n];
+  struct addrinfo *rp;
+  int mysocket;
+
+  while ((rp = sp->nextaddr) != NIL) {
+    sp->nextaddr = rp->ai_next;
+    mysocket = socket(rp->ai_family, SOCK_STREAM, 0);
+    if (mysocket == -1) continue;
+    fcntl(mysocket, F_SETFL, O_NONBLOCK);
+    if (connect(mysocket, rp->ai_addr, rp->ai_addrlen) == 0) {
+      freeaddrinfo(sp->addrs);
+      sp->addrs = sp->nextaddr = NIL;
+      sp->state = NETSTATE_OPEN;
+      watch_socket(n, mysocket);
+      net_flush(n);	/* Send anything written while waiting */
+      return;
+    }
+    if (errno == EINPROGRESS) {
+      sp->state = NETSTATE_CONNECTING;
+      watch_socket(n, mysocket);
+      return;
+    }
+    close(mysocket);
+  }
+  net_failed(n, ERR_NET_CONNREFUSED);
+}
+
+/*
+** 'finish_connect' is called when the socket for entry 'n' of the socket
+** table is ready after a non-blocking connect() to see if it worked. If
+** it did not, the next address is tried
+*/
+static void finish_connect(int n) {
+  netsocket *sp = &netsockets[n];
+  int err = 0;
+  socklen_t errlen = sizeof(err);
+
+  if (getsockopt(sp->socket, SOL_SOCKET, SO_ERROR, &err, &errlen) == -1) err = errno;
+  if (err == 0) {
+    freeaddrinfo(sp->addrs);
+    sp->addrs = sp->nextaddr = NIL;
+    sp->state = NETSTATE_OPEN;
+    net_flush(n);	/* Send anything written while waiting */
+    return;
+  }
+  unwatch_socket(n);
+  start_connect(n);
+}
+
+/*
+** 'net_progress' moves on any connections whose host name look-ups
+** have finished
+*/
+static void net_progress(void) {
+  char junk[64];
+  int n, done, found = 0;
+  netlookup *lp;
+
+  if (netwakeup[0] == -1) return;
+  while (read(netwakeup[0], junk, sizeof(junk)) > 0) found = 1;
+  if (!found) return;
+  for (n=0; n<netcount; n++) {
+    if (netsockets[n].state != NETSTATE_RESOLVING) continue;
+    lp = netsockets[n].lookup;
+    pthread_mutex_lock(&netlookuplock);
+    done = lp->done;
+    pthread_mutex_unlock(&netlookuplock);
+    if (!done) continue;
+    netsockets[n].lookup = NIL;
+    if (lp->status != 0) {
+      free_lookup(lp);
+      net_failed(n, ERR_NET_NOTFOUND);
+    } else {
+      netsockets[n].addrs = netsockets[n].nextaddr = lp->result;
+      lp->result = NIL;
+      free_lookup(lp);
+      start_connect(n);
+    }
+  }
+}
+
+/*
+** 'net_update' brings the state of entry 'handle' of the socket table
+** up to date without waiting
+*/
+static void net_update(int handle);
+#endif /* TARGET_UNIX */
+
 int brandynet_connect(char *dest, char type) {
 #ifdef TARGET_RISCOS
   char *host, *port;
@@ -175,13 +554,7 @@ int brandynet_connect(char *dest, char type) {
     return(-1);
   }
 
-  for (n=0; n<MAXNETSOCKETS; n++) {
-    if (!netsockets[n]) break;
-  }
-  if (MAXNETSOCKETS == n) {
-    error(ERR_NET_MAXSOCKETS);
-    return(-1);
-  }
+  n = find_netslot();
 
   host=strdup(dest);
   port=strchr(host,':');
@@ -220,7 +593,7 @@ int brandynet_connect(char *dest, char type) {
   /* SharedCLibrary doesn't support this */
   fcntl(mysocket, F_SETFL, O_NONBLOCK);
 #endif
-  netsockets[n] = mysocket;
+  claim_netslot(n, mysocket);
   return(n);
 
 #else /* not TARGET_RISCOS */
@@ -236,13 +609,7 @@ int brandynet_connect(char *dest, char type) {
     return(-1);
   }
 
-  for (n=0; n<MAXNETSOCKETS; n++) {
-    if (!netsockets[n]) break;
-  }
-  if (MAXNETSOCKETS == n) {
-    error(ERR_NET_MAXSOCKETS);
-    return(-1);
-  }
+  n = find_netslot();
 
   memset(&hints, 0, sizeof(hints));
   if (type == '0') hints.ai_family=AF_UNSPEC;
@@ -257,6 +624,13 @@ int brandynet_connect(char *dest, char type) {
   port[0]='\0';
   port++;
 
+#ifdef TARGET_UNIX
+  if (matrixflags.asyncconnect) {	/* Return now and make the connection in the background */
+    start_lookup(n, host, port, &hints);
+    return(n);
+  }
+#endif
+
   ret=getaddrinfo(host, port, &hints, &addrdata);
   free(host);				/* Don't need this any more */
 
@@ -289,14 +663,232 @@ int brandynet_connect(char *dest, char type) {
 #else
   fcntl(mysocket, F_SETFL, O_NONBLOCK);
 #endif
-  netsockets[n] = mysocket;
+  claim_netslot(n, mysocket);
   return(n);
 #endif /* RISCOS */
 }
 
+/*
+** 'brandynet_listen' opens a socket listening for incoming connections.
+** 'dest' is of the form "host:port" or "host:port,backlog". If the host
+** is empty, connections are accepted on all addresses. The socket is
+** set up with SO_REUSEPORT where available so that several listeners
+** can share a port. Connections are taken with 'brandynet_accept'
+*/
+int brandynet_listen(char *dest, char type) {
+#if defined(TARGET_RISCOS) || defined(TARGET_MINGW)
+  error(ERR_NET_NOTSUPP);
+  return(-1);
+#else
+  char *host, *port, *backlog;
+  int n, mysocket=-1, ret, opt, queuelen = SOMAXCONN;
+  struct addrinfo hints, *addrdata, *rp;
+
+  if(matrixflags.networking==0) {
+    error(ERR_NET_NOTSUPP);
+    return(-1);
+  }
+
+  n = find_netslot();
+
+  memset(&hints, 0, sizeof(hints));
+  if (type == '0') hints.ai_family=AF_UNSPEC;
+  else if (type == '4') hints.ai_family=AF_INET;
+  else if (type == '6') hints.ai_family=AF_INET6;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  hints.ai_protocol = IPPROTO_TCP;
+
+  host=strdup(dest);
+  port=strrchr(host,':');
+  if (port == NULL) {
+    free(host);
+    error(ERR_NET_NOTFOUND);
+    return(-1);
+  }
+  port[0]='\0';
+  port++;
+  backlog=strchr(port,',');
+  if (backlog != NULL) {
+    backlog[0]='\0';
+    queuelen=atoi(backlog+1);
+    if (queuelen <= 0) queuelen = SOMAXCONN;
+  }
+
+  ret=getaddrinfo(host[0] == '\0' ? NULL : host, port, &hints, &addrdata);
+  free(host);
+
+  if(ret) {
+#ifdef DEBUG
+    if (basicvars.debug_flags.debug) fprintf(stderr, "getaddrinfo returns: %s\n", gai_strerror(ret));
+#endif
+    error(ERR_NET_NOTFOUND);
+    return(-1);
+  }
+
+  for(rp = addrdata; rp != NULL; rp = rp->ai_next) {
+    mysocket = socket(rp->ai_family, SOCK_STREAM, 0);
+    if (mysocket == -1) continue;
+    opt = 1;
+    setsockopt(mysocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+#ifdef SO_REUSEPORT
+    setsockopt(mysocket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+#endif
+    if (bind(mysocket, rp->ai_addr, rp->ai_addrlen) == 0 && listen(mysocket, queuelen) == 0)
+      break; /* success! */
+    close(mysocket);
+  }
+
+  freeaddrinfo(addrdata);
+
+  if (!rp) {
+    error(ERR_NET_CONNREFUSED);
+    return(-1);
+  }
+
+  fcntl(mysocket, F_SETFL, O_NONBLOCK);
+  claim_netslot(n, mysocket);
+  return(n);
+#endif
+}
+
+/*
+** 'brandynet_accept' takes the next incoming connection on listening
+** socket 'handle' and returns the socket table index of the new
+** connection. It does not wait: if no connection is pending, it
+** returns -1
+*/
+int brandynet_accept(int handle) {
+#if defined(TARGET_RISCOS) || defined(TARGET_MINGW)
+  error(ERR_NET_NOTSUPP);
+  return(-1);
+#else
+  int n, mysocket;
+
+  n = find_netslot();
+  do {		/* Skip connections aborted while still queued */
+    mysocket = accept(netsockets[handle].socket, NULL, NULL);
+  } while (mysocket == -1 && (errno == ECONNABORTED || errno == EINTR));
+  if (mysocket == -1) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) error(ERR_NET_NOTSUPP);
+    netsockets[handle].ready &= ~NET_READABLE;	/* Queue is empty */
+    return(-1);
+  }
+  fcntl(mysocket, F_SETFL, O_NONBLOCK);
+  claim_netslot(n, mysocket);
+  return(n);
+#endif
+}
+
+/*
+** 'brandynet_udp' opens a UDP socket. 'dest' is of the form "host:port".
+** Datagrams written to the socket go to that address and only those
+** coming from it are received. If the host is left out (":port"), the
+** socket receives datagrams sent to that port on any address and
+** anything written to it goes back to the sender of the last datagram
+** read. Each BPUT# sends one datagram and each GET$# returns the rest of
+** one datagram
+*/
+int brandynet_udp(char *dest, char type) {
+#ifdef TARGET_RISCOS
+  error(ERR_NET_NOTSUPP);
+  return(-1);
+#else
+  char *host, *port;
+  int n, mysocket=-1, ret, bound;
+  struct addrinfo hints, *addrdata, *rp;
+#ifdef TARGET_MINGW
+  unsigned long opt;
+#endif
+
+  if(matrixflags.networking==0) {
+    error(ERR_NET_NOTSUPP);
+    return(-1);
+  }
+
+  n = find_netslot();
+
+  memset(&hints, 0, sizeof(hints));
+  if (type == '0') hints.ai_family=AF_UNSPEC;
+  else if (type == '4') hints.ai_family=AF_INET;
+  else if (type == '6') hints.ai_family=AF_INET6;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_protocol = IPPROTO_UDP;
+
+  host=strdup(dest);
+  port=strrchr(host,':');
+  if (port == NULL) {
+    free(host);
+    error(ERR_NET_NOTFOUND);
+    return(-1);
+  }
+  port[0]='\0';
+  port++;
+  bound = host[0] == '\0';
+  hints.ai_flags = bound ? AI_PASSIVE : AI_ADDRCONFIG;
+
+  ret=getaddrinfo(bound ? NULL : host, port, &hints, &addrdata);
+  free(host);
+
+  if(ret) {
+#ifdef DEBUG
+    if (basicvars.debug_flags.debug) fprintf(stderr, "getaddrinfo returns: %s\n", gai_strerror(ret));
+#endif
+    error(ERR_NET_NOTFOUND);
+    return(-1);
+  }
+
+  for(rp = addrdata; rp != NULL; rp = rp->ai_next) {
+    mysocket = socket(rp->ai_family, SOCK_DGRAM, 0);
+    if (mysocket == -1) continue;
+    if (bound) ret = bind(mysocket, rp->ai_addr, rp->ai_addrlen);
+    else ret = connect(mysocket, rp->ai_addr, rp->ai_addrlen);
+    if (ret == 0) break; /* success! */
+    close(mysocket);
+  }
+
+  freeaddrinfo(addrdata);
+
+  if (!rp) {
+    error(ERR_NET_CONNREFUSED);
+    return(-1);
+  }
+
+#ifdef TARGET_MINGW
+  opt=1;
+  ioctlsocket(mysocket, FIONBIO, &opt);
+#else
+  fcntl(mysocket, F_SETFL, O_NONBLOCK);
+#endif
+  claim_netslot(n, mysocket);
+  netsockets[n].datagram = bound ? NETDGRAM_BOUND : NETDGRAM_CONNECTED;
+  return(n);
+#endif
+}
+
 int brandynet_close(int handle) {
-  close(netsockets[handle]);
-  netsockets[handle] = neteof[handle] = 0;
+  netsocket *sp = &netsockets[handle];
+
+  if (sp->state == NETSTATE_OPEN) net_flush(handle);
+#ifdef TARGET_UNIX
+  if (sp->lookup != NIL) {	/* Look-up still in progress - Let the thread tidy up */
+    pthread_mutex_lock(&netlookuplock);
+    if (sp->lookup->done)
+      free_lookup(sp->lookup);
+    else
+      sp->lookup->abandoned = 1;
+    pthread_mutex_unlock(&netlookuplock);
+    sp->lookup = NIL;
+  }
+#endif
+  if (sp->addrs != NIL) freeaddrinfo(sp->addrs);
+  sp->addrs = sp->nextaddr = NIL;
+  unwatch_socket(handle);
+  sp->state = NETSTATE_FREE;
+  free(netsockets[handle].buffer);
+  netsockets[handle].buffer = NIL;
+  free(netsockets[handle].sendbuf);
+  netsockets[handle].sendbuf = NIL;
   return(0);
 }
 
@@ -307,52 +899,867 @@ int brandynet_close(int handle) {
 
 static int net_get_something(int handle) {
   int retval = 0;
+  netsocket *sp = &netsockets[handle];
 
-  bufendptr[handle] = recv(netsockets[handle], netbuffer[handle], MAXNETRCVLEN, MSG_DONTWAIT);
-  if (bufendptr[handle] == 0) {
+  if (sp->buffer == NIL) {
+    sp->buffer = malloc(MAXNETRCVLEN);
+    if (sp->buffer == NIL) error(ERR_NOROOM);
+  }
+#ifndef TARGET_RISCOS
+  if (sp->datagram != NETDGRAM_NONE) {
+/*
+** Each read takes one datagram, which may be empty. There may be more
+** datagrams waiting, so the socket stays readable until one is not found
+*/
+    struct sockaddr_storage from;
+    socklen_t fromlen = sizeof(from);
+    sp->bufendptr = recvfrom(sp->socket, sp->buffer, MAXNETRCVLEN, MSG_DONTWAIT, (struct sockaddr *)&from, &fromlen);
+    if (sp->bufendptr == -1) {
+      sp->bufendptr = 0;
+      sp->ready &= ~NET_READABLE;
+    } else if (sp->datagram == NETDGRAM_BOUND) {
+      memcpy(&sp->peer, &from, fromlen);
+      sp->peerlen = fromlen;
+    }
+    sp->bufptr = 0;
+    return(0);
+  }
+#endif
+  sp->bufendptr = recv(sp->socket, sp->buffer, MAXNETRCVLEN, MSG_DONTWAIT);
+  if (sp->bufendptr == 0) {
     retval=1; /* EOF - connection closed */
-    neteof[handle] = 1;
+    sp->eof = 1;
   }
-  if (bufendptr[handle] == -1) bufendptr[handle] = 0;
-  bufptr[handle] = 0;
+/*
+** If the socket has been emptied, it is not readable again until epoll
+** reports that more data has arrived
+*/
+  if (sp->bufendptr == -1) sp->bufendptr = 0;
+  if (sp->bufendptr < MAXNETRCVLEN && !sp->eof) sp->ready &= ~NET_READABLE;
+  sp->bufptr = 0;
   return(retval);
 }
 
 int32 net_bget(int handle) {
   int value;
   int retval=0;
+  netsocket *sp = &netsockets[handle];
 
-  if (neteof[handle]) return(-2);
-  if (bufptr[handle] >= bufendptr[handle]) {
+#ifdef TARGET_UNIX
+  if (sp->state != NETSTATE_OPEN) {
+    net_update(handle);
+    if (sp->state == NETSTATE_FAILED) return(-2);
+    if (sp->state != NETSTATE_OPEN) return(-1);	/* Not connected yet */
+  }
+#endif
+  if (sp->eof) return(-2);
+  if (sp->bufptr >= sp->bufendptr) {
+    net_flushall();	/* Send any request before looking for the reply */
     retval=net_get_something(handle);
     if (retval) return(-2);				/* EOF */
   }
-  if (bufptr[handle] >= bufendptr[handle]) return(-1);	/* No data available. EOF NOT set */
-  value=netbuffer[handle][(bufptr[handle])];
-  bufptr[handle]++;
+  if (sp->bufptr >= sp->bufendptr) return(-1);	/* No data available. EOF NOT set */
+  value=sp->buffer[sp->bufptr];
+  sp->bufptr++;
   return(value);
 }
 
 boolean net_eof(int handle) {
-  return(neteof[handle]);
+  return(netsockets[handle].eof || netsockets[handle].state == NETSTATE_FAILED);
+}
+
+/*
+** 'net_getline' reads a line from socket 'handle' into 'buffer' for
+** GET$#. It returns what has arrived up to the next newline, or as much
+** as there is if no newline has been received yet. On a UDP socket it
+** returns the rest of the current datagram. Any newline at the end is
+** removed. The length of the line is returned
+*/
+int32 net_getline(int handle, char *buffer, int32 size) {
+  netsocket *sp = &netsockets[handle];
+  int32 ch, length = 0;
+
+  if (sp->datagram != NETDGRAM_NONE) {
+    if (sp->bufptr >= sp->bufendptr) net_get_something(handle);
+    length = sp->bufendptr-sp->bufptr;
+    if (length > size) length = size;
+    memcpy(buffer, sp->buffer+sp->bufptr, length);
+    sp->bufptr+=length;
+    if (length > 0 && buffer[length-1] == '\n') length--;
+  } else {
+    while (length < size) {
+      ch = net_bget(handle);
+      if (ch < 0 || ch == '\n') break;
+      buffer[length++] = ch;
+    }
+  }
+  if (length > 0 && buffer[length-1] == '\r') length--;
+  return(length);
 }
 
 int net_bput(int handle, int32 value) {
   char minibuf[2];
-  int retval;
 
   minibuf[0]=(value & 0xFFu);
   minibuf[1]=0;
-  retval=send(netsockets[handle], (const char *)&minibuf, 1, 0);
-  if (retval == -1) return(1);
+  return(net_bputstr(handle, minibuf, 1));
+}
+
+/*
+** 'net_sendwait' is called when a write to socket 'handle' failed
+** because the system's buffer for the socket is full. It waits for
+** there to be room, checking for Escape every so often in case the
+** other end has stopped reading. It returns 0 if the write should be
+** tried again or 1 if the error was something else
+*/
+static int net_sendwait(int handle) {
+#ifdef TARGET_UNIX
+  struct pollfd fd;
+  int result;
+#endif
+
+  if (errno == EINTR) {
+    if (basicvars.escape) error(ERR_ESCAPE);
+    return(0);
+  }
+  if (errno != EAGAIN && errno != EWOULDBLOCK) return(1);
+  netsockets[handle].ready &= ~NET_WRITABLE;
+#ifdef TARGET_UNIX
+  fd.fd = netsockets[handle].socket;
+  fd.events = POLLOUT;
+  do {
+    result = poll(&fd, 1, NETPOLLTIME);
+    if (basicvars.escape) error(ERR_ESCAPE);
+    if (result == -1 && errno != EINTR) return(1);
+  } while (result <= 0);
+#endif
   return(0);
 }
 
-int net_bputstr(int handle, char *string, int32 length) {
+/*
+** 'net_send' sends 'length' bytes at 'string' on socket 'handle'. The
+** socket is non-blocking, so if the system's buffer for the socket is
+** full, it waits for room rather than losing what is left over.
+** It returns 0 if everything was sent or 1 if there was an error
+*/
+static int net_send(int handle, char *string, int32 length) {
   int retval;
 
-  retval=send(netsockets[handle], string, length, 0);
-  if (retval == -1) return(1);
+  while (length > 0) {
+    retval=send(netsockets[handle].socket, string, length, 0);
+    if (retval == -1) {
+      if (net_sendwait(handle)) return(1);
+      continue;
+    }
+    string+=retval;
+    length-=retval;
+  }
   return(0);
 }
+
+#ifndef TARGET_RISCOS
+/*
+** 'net_senddatagram' sends 'length' bytes at 'string' as one datagram
+** on UDP socket 'handle'. It returns 0 if it was sent or 1 if there
+** was an error, including there being nowhere to send it
+*/
+static int net_senddatagram(int handle, char *string, int32 length) {
+  netsocket *sp = &netsockets[handle];
+  int retval;
+
+  if (sp->datagram == NETDGRAM_BOUND && sp->peerlen == 0) return(1);	/* No-one to reply to */
+  do {
+    if (sp->datagram == NETDGRAM_BOUND)
+      retval=sendto(sp->socket, string, length, 0, (struct sockaddr *)&sp->peer, sp->peerlen);
+    else
+      retval=send(sp->socket, string, length, 0);
+    if (retval != -1) return(0);
+  } while (!net_sendwait(handle));
+  return(1);
+}
+#endif
+
+#ifdef TARGET_UNIX
+/*
+** 'net_waitopen' waits until the connection for socket 'handle' has
+** been made or has failed. It returns 0 if the socket is open or 1
+** if not
+*/
+static int net_waitopen(int handle) {
+  netsocket *sp = &netsockets[handle];
+  int32 events;
+
+  while (sp->state == NETSTATE_RESOLVING || sp->state == NETSTATE_CONNECTING) {
+    events = NET_WRITABLE;
+    net_wait(&handle, &events, 1, -1);
+  }
+  return(sp->state != NETSTATE_OPEN);
+}
+#endif
+
+/*
+** 'net_flush' sends any output collected for socket 'handle'. It
+** returns 0 if everything was sent or 1 if there was an error. What
+** has been sent is removed from the buffer as it goes, so output that
+** could not be sent is kept rather than lost
+*/
+int net_flush(int handle) {
+  netsocket *sp = &netsockets[handle];
+  int retval;
+
+  if (sp->state == NETSTATE_FAILED) return(1);
+  if (sp->sendlen == 0 || sp->state != NETSTATE_OPEN) return(0);	/* Nothing to send or cannot send it yet */
+  while (sp->sendlen > 0) {
+    retval = send(sp->socket, sp->sendbuf, sp->sendlen, 0);
+    if (retval == -1) {
+      if (net_sendwait(handle)) return(1);
+      continue;
+    }
+    sp->sendlen-=retval;
+    if (sp->sendlen > 0) memmove(sp->sendbuf, sp->sendbuf+retval, sp->sendlen);
+  }
+  return(0);
+}
+
+/*
+** 'net_flushall' sends the output collected for every socket. It is
+** used before the interpreter waits for anything, as the program could
+** be waiting for the reply to something it has written on any of its
+** connections. Errors are left to be reported by the next write to or
+** flush of the socket concerned
+*/
+void net_flushall(void) {
+  int n, unsent = 0;
+
+  if (!netunsent) return;
+  for (n=0; n<netcount; n++) {
+    if (netsockets[n].state == NETSTATE_FREE || netsockets[n].sendlen == 0) continue;
+    net_flush(n);
+    if (netsockets[n].sendlen > 0) unsent = 1;
+  }
+  netunsent = unsent;
+}
+
+/*
+** 'net_bputstr' adds a string to the output waiting to be sent on
+** socket 'handle', so that programs that write a byte or a few bytes
+** at a time do not make a system call for each one. The buffer is sent
+** when it fills up, before reading from or waiting on the socket, when
+** the socket is closed and when the program asks for it to be sent
+** with 'net_control'. Strings too big for the buffer go straight out
+*/
+int net_bputstr(int handle, char *string, int32 length) {
+  netsocket *sp = &netsockets[handle];
+
+#ifdef TARGET_UNIX
+  if (sp->state != NETSTATE_OPEN) {
+/*
+** Output for a connection that has not been made yet is kept until
+** it has. Wait for it to be made if there is no room to keep it
+*/
+    net_update(handle);
+    if (!sp->buffered || sp->sendlen+length > MAXNETSENDLEN) net_waitopen(handle);
+    if (sp->state == NETSTATE_FAILED) return(1);
+  }
+#endif
+#ifndef TARGET_RISCOS
+  if (sp->datagram != NETDGRAM_NONE) return(net_senddatagram(handle, string, length));
+#endif
+  if (!sp->buffered) return(net_send(handle, string, length));
+  if (sp->sendlen+length > MAXNETSENDLEN) {
+    if (net_flush(handle)) return(1);
+    if (length >= MAXNETSENDLEN) return(net_send(handle, string, length));
+  }
+  if (sp->sendbuf == NIL) {
+    sp->sendbuf = malloc(MAXNETSENDLEN);
+    if (sp->sendbuf == NIL) error(ERR_NOROOM);
+  }
+  memcpy(sp->sendbuf+sp->sendlen, string, length);
+  sp->sendlen+=length;
+  netunsent = 1;
+  return(0);
+}
+
+/*
+** 'net_sendbatch' sends 'count' datagrams on UDP socket 'handle'. The
+** datagrams are stored one after the other starting at 'data' and
+** their lengths are in the array 'lengths'. On Linux they are handed
+** to the system up to NETBATCH at a time with sendmmsg(). It waits if
+** the system's buffer for the socket is full and returns the number of
+** datagrams sent, which is less than 'count' if there was an error
+*/
+int32 net_sendbatch(int handle, char *data, int32 *lengths, int32 count) {
+#ifdef TARGET_RISCOS
+  error(ERR_NET_NOTSUPP);
+  return(0);
+#else
+  netsocket *sp = &netsockets[handle];
+  int32 n, sent = 0;
+#ifdef TARGET_LINUX
+  struct mmsghdr msgs[NETBATCH];
+  struct iovec iovs[NETBATCH];
+  int32 batch;
+  char *p;
+#endif
+
+  if (sp->datagram == NETDGRAM_NONE) error(ERR_NET_NOTSUPP);
+  for (n=0; n<count; n++) {
+    if (lengths[n] < 0) error(ERR_RANGE);
+  }
+  if (sp->datagram == NETDGRAM_BOUND && sp->peerlen == 0) return(0);	/* No-one to send to */
+#ifdef TARGET_LINUX
+  while (sent < count) {
+    batch = count-sent;
+    if (batch > NETBATCH) batch = NETBATCH;
+    p = data;
+    memset(msgs, 0, batch*sizeof(struct mmsghdr));
+    for (n=0; n<batch; n++) {
+      iovs[n].iov_base = p;
+      iovs[n].iov_len = lengths[sent+n];
+      p+=lengths[sent+n];
+      msgs[n].msg_hdr.msg_iov = &iovs[n];
+      msgs[n].msg_hdr.msg_iovlen = 1;
+      if (sp->datagram == NETDGRAM_BOUND) {
+        msgs[n].msg_hdr.msg_name = &sp->peer;
+        msgs[n].msg_hdr.msg_namelen = sp->peerlen;
+      }
+    }
+    n = sendmmsg(sp->socket, msgs, batch, 0);
+    if (n == -1) {
+      if (net_sendwait(handle)) break;
+      continue;
+    }
+    while (n > 0) {
+      data+=lengths[sent];
+      sent++;
+      n--;
+    }
+  }
+#else
+  while (sent < count && net_senddatagram(handle, data, lengths[sent]) == 0) {
+    data+=lengths[sent];
+    sent++;
+  }
+#endif
+  return(sent);
+#endif
+}
+
+/*
+** 'net_recvbatch' reads up to 'count' datagrams waiting on UDP socket
+** 'handle' without waiting for more to arrive. Datagram 'n' is stored
+** at 'buffer'+'n'*'slotsize' and its length put in 'lengths[n]'.
+** Datagrams longer than 'slotsize' are cut short. On Linux they are
+** taken up to NETBATCH at a time with recvmmsg(). It returns the number
+** of datagrams read
+*/
+int32 net_recvbatch(int handle, char *buffer, int32 slotsize, int32 *lengths, int32 count) {
+#ifdef TARGET_RISCOS
+  error(ERR_NET_NOTSUPP);
+  return(0);
+#else
+  netsocket *sp = &netsockets[handle];
+  int32 n, got = 0;
+#ifdef TARGET_LINUX
+  struct mmsghdr msgs[NETBATCH];
+  struct iovec iovs[NETBATCH];
+  struct sockaddr_storage senders[NETBATCH];
+  int32 batch;
+#else
+  struct sockaddr_storage from;
+  socklen_t fromlen;
+#endif
+
+  if (sp->datagram == NETDGRAM_NONE) error(ERR_NET_NOTSUPP);
+  if (slotsize < 0) error(ERR_RANGE);
+#ifdef TARGET_LINUX
+  while (got < count) {
+    batch = count-got;
+    if (batch > NETBATCH) batch = NETBATCH;
+    memset(msgs, 0, batch*sizeof(struct mmsghdr));
+    for (n=0; n<batch; n++) {
+      iovs[n].iov_base = buffer+(size_t)(got+n)*slotsize;
+      iovs[n].iov_len = slotsize;
+      msgs[n].msg_hdr.msg_iov = &iovs[n];
+      msgs[n].msg_hdr.msg_iovlen = 1;
+      msgs[n].msg_hdr.msg_name = &senders[n];
+      msgs[n].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+    }
+    n = recvmmsg(sp->socket, msgs, batch, MSG_DONTWAIT, NULL);
+    if (n == -1) {
+      if (errno == EINTR) continue;
+      sp->ready &= ~NET_READABLE;	/* Nothing more waiting */
+      break;
+    }
+    if (n > 0 && sp->datagram == NETDGRAM_BOUND) {
+      memcpy(&sp->peer, &senders[n-1], msgs[n-1].msg_hdr.msg_namelen);
+      sp->peerlen = msgs[n-1].msg_hdr.msg_namelen;
+    }
+    for (batch=0; batch<n; batch++) lengths[got++] = msgs[batch].msg_len;
+  }
+#else
+  while (got < count) {
+    fromlen = sizeof(from);
+    n = recvfrom(sp->socket, buffer+(size_t)got*slotsize, slotsize, MSG_DONTWAIT, (struct sockaddr *)&from, &fromlen);
+    if (n == -1) {
+      if (errno == EINTR) continue;
+      sp->ready &= ~NET_READABLE;
+      break;
+    }
+    if (sp->datagram == NETDGRAM_BOUND) {
+      memcpy(&sp->peer, &from, fromlen);
+      sp->peerlen = fromlen;
+    }
+    lengths[got++] = n;
+  }
+#endif
+  return(got);
+#endif
+}
+
+/*
+** 'net_sendfile' sends up to 'count' bytes of the file with descriptor
+** 'fd' on socket 'handle', starting at offset 'offset' in the file. If
+** 'count' is -1 the rest of the file is sent. On Linux sendfile() is
+** used, so the data goes from the file to the socket without being
+** copied through the interpreter. Elsewhere, or if the file is of a
+** kind sendfile() cannot deal with, it is read and sent in blocks. The
+** number of bytes sent is stored at 'done' and one of the NETXFER_xxx
+** values returned
+*/
+int32 net_sendfile(int handle, int fd, int64 offset, int64 count, int64 *done) {
+  netsocket *sp = &netsockets[handle];
+  int64 chunk;
+  int32 length;
+
+  *done = 0;
+  if (sp->datagram != NETDGRAM_NONE) error(ERR_NET_NOTSUPP);
+#ifdef TARGET_UNIX
+  if (sp->state != NETSTATE_OPEN && net_waitopen(handle)) return(NETXFER_ERROR);
+#endif
+  if (net_flush(handle)) return(NETXFER_ERROR);	/* Anything already written goes first */
+#ifdef TARGET_LINUX
+  while (count < 0 || *done < count) {
+    off_t position = offset+*done;
+    ssize_t sent;
+    chunk = count < 0 || count-*done > MAXNETXFER ? MAXNETXFER : count-*done;
+    sent = sendfile(sp->socket, fd, &position, chunk);
+    if (sent == 0) return(NETXFER_END);
+    if (sent == -1) {
+      if (errno == EINVAL || errno == ENOSYS) break;	/* Not possible with this file - Do it the long way */
+      if (net_sendwait(handle)) return(NETXFER_ERROR);
+      if (basicvars.escape) error(ERR_ESCAPE);
+      continue;
+    }
+    *done+=sent;
+  }
+  if (count >= 0 && *done >= count) return(NETXFER_DONE);
+#endif
+  if (sp->sendbuf == NIL) {
+    sp->sendbuf = malloc(MAXNETSENDLEN);
+    if (sp->sendbuf == NIL) error(ERR_NOROOM);
+  }
+  while (count < 0 || *done < count) {
+    chunk = count < 0 || count-*done > MAXNETSENDLEN ? MAXNETSENDLEN : count-*done;
+#ifdef TARGET_UNIX
+    length = pread(fd, sp->sendbuf, chunk, offset+*done);
+#else
+    if (lseek(fd, offset+*done, SEEK_SET) == -1) return(NETXFER_ERROR);
+    length = read(fd, sp->sendbuf, chunk);
+#endif
+    if (length == 0) return(NETXFER_END);
+    if (length < 0) return(NETXFER_ERROR);
+    if (net_send(handle, sp->sendbuf, length)) return(NETXFER_ERROR);
+    *done+=length;
+    if (basicvars.escape) error(ERR_ESCAPE);
+  }
+  return(NETXFER_DONE);
+}
+
+#ifdef TARGET_UNIX
+/*
+** 'net_recvwait' waits for data to arrive on socket 'handle',
+** checking for Escape every so often
+*/
+static void net_recvwait(int handle) {
+  struct pollfd fd;
+  int result;
+
+  netsockets[handle].ready &= ~NET_READABLE;
+  fd.fd = netsockets[handle].socket;
+  fd.events = POLLIN;
+  do {
+    result = poll(&fd, 1, NETPOLLTIME);
+    if (basicvars.escape) error(ERR_ESCAPE);
+  } while (result == 0 || (result == -1 && errno == EINTR));
+}
+
+/*
+** 'net_writefile' writes 'length' bytes at 'data' to the file with
+** descriptor 'fd' at offset 'offset'. It returns 0 if it worked or 1
+** if it failed
+*/
+static int net_writefile(int fd, char *data, int32 length, int64 offset) {
+  ssize_t written;
+
+  while (length > 0) {
+    written = pwrite(fd, data, length, offset);
+    if (written == -1 && errno == EINTR) continue;
+    if (written <= 0) return(1);
+    data+=written;
+    length-=written;
+    offset+=written;
+  }
+  return(0);
+}
+
+#ifdef TARGET_LINUX
+/*
+** 'net_pipetofile' moves 'length' bytes from the pipe 'netsplice' to
+** the file with descriptor 'fd' at offset 'offset', using splice() if
+** the file allows it or going through buffer 'buffer' if not. It
+** returns 0 if it worked or 1 if it failed, in which case the pipe is
+** emptied
+*/
+static int net_pipetofile(int fd, int32 length, int64 offset, char *buffer) {
+  ssize_t moved;
+  loff_t position;
+
+  while (length > 0) {
+    position = offset;
+    moved = splice(netsplice[0], NULL, fd, &position, length, SPLICE_F_MOVE);
+    if (moved == -1 && errno == EINTR) continue;
+    if (moved <= 0) {		/* File cannot be spliced to. Copy it instead */
+      moved = read(netsplice[0], buffer, length > MAXNETRCVLEN ? MAXNETRCVLEN : length);
+      if (moved <= 0 || net_writefile(fd, buffer, moved, offset)) {
+        while (read(netsplice[0], buffer, MAXNETRCVLEN) > 0);
+        return(1);
+      }
+    }
+    length-=moved;
+    offset+=moved;
+  }
+  return(0);
+}
+#endif
+
+/*
+** 'net_recvfile' writes up to 'count' bytes received on socket 'handle'
+** to the file with descriptor 'fd', starting at offset 'offset' in the
+** file. It waits for data to arrive until 'count' bytes have been
+** written or the connection is closed. If 'count' is -1 it carries on
+** until the connection is closed. On Linux splice() is used to move
+** the data through a pipe without it being copied through the
+** interpreter. The number of bytes written is stored at 'done' and one
+** of the NETXFER_xxx values returned
+*/
+int32 net_recvfile(int handle, int fd, int64 offset, int64 count, int64 *done) {
+  netsocket *sp = &netsockets[handle];
+  int64 chunk;
+  int32 length;
+#ifdef TARGET_LINUX
+  ssize_t moved;
+#endif
+
+  *done = 0;
+  if (sp->datagram != NETDGRAM_NONE) error(ERR_NET_NOTSUPP);
+  if (sp->state != NETSTATE_OPEN && net_waitopen(handle)) return(NETXFER_ERROR);
+  if (net_flush(handle)) return(NETXFER_ERROR);	/* Send any request before waiting for the reply */
+  if (sp->buffer == NIL) {
+    sp->buffer = malloc(MAXNETRCVLEN);
+    if (sp->buffer == NIL) error(ERR_NOROOM);
+  }
+#ifdef TARGET_LINUX
+  if (netsplice[0] == -1 && pipe(netsplice) == 0) {
+    fcntl(netsplice[0], F_SETFD, FD_CLOEXEC);
+    fcntl(netsplice[1], F_SETFD, FD_CLOEXEC);
+  }
+#endif
+  while (count < 0 || *done < count) {
+    chunk = count < 0 || count-*done > MAXNETRCVLEN ? MAXNETRCVLEN : count-*done;
+    if (sp->bufptr < sp->bufendptr) {	/* Write out what has already been read first */
+      length = sp->bufendptr-sp->bufptr;
+      if (length > chunk) length = chunk;
+      if (net_writefile(fd, sp->buffer+sp->bufptr, length, offset+*done)) return(NETXFER_ERROR);
+      sp->bufptr+=length;
+      *done+=length;
+      continue;
+    }
+    if (sp->eof) return(NETXFER_END);
+#ifdef TARGET_LINUX
+    if (netsplice[0] != -1) {
+      moved = splice(sp->socket, NULL, netsplice[1], NULL, chunk, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (moved == 0) {
+        sp->eof = 1;
+        return(NETXFER_END);
+      }
+      if (moved > 0) {
+        if (net_pipetofile(fd, moved, offset+*done, sp->buffer)) return(NETXFER_ERROR);
+        *done+=moved;
+        continue;
+      }
+      if (errno == EAGAIN) {
+        net_recvwait(handle);
+        continue;
+      }
+      if (errno != EINTR && errno != EINVAL) return(NETXFER_ERROR);
+      if (errno == EINVAL) {	/* Socket cannot be spliced from. Copy it instead */
+        close(netsplice[0]);
+        close(netsplice[1]);
+        netsplice[0] = netsplice[1] = -1;
+      }
+      continue;
+    }
+#endif
+    net_get_something(handle);
+    if (sp->bufptr >= sp->bufendptr && !sp->eof) net_recvwait(handle);
+  }
+  return(NETXFER_DONE);
+}
+#endif
+
+/*
+** 'net_control' carries out one of the NETCTL_xxx operations on socket
+** 'handle'. It returns 0 if it worked or 1 if it failed
+*/
+int net_control(int handle, int32 reason, int32 value) {
+  int opt = value != 0;
+
+  if (netsockets[handle].socket == -1 && reason >= NETCTL_NODELAY) return(1);	/* Not connected yet */
+
+  switch (reason) {
+  case NETCTL_FLUSH:
+    return(net_flush(handle));
+  case NETCTL_BUFFER:
+    if (!opt && net_flush(handle)) return(1);
+    netsockets[handle].buffered = opt;
+    return(0);
+  case NETCTL_NODELAY:
+    return(setsockopt(netsockets[handle].socket, IPPROTO_TCP, TCP_NODELAY, (char *)&opt, sizeof(opt)) != 0);
+  case NETCTL_CORK:
+    if (!opt && net_flush(handle)) return(1);
+#if defined(TCP_CORK)
+    return(setsockopt(netsockets[handle].socket, IPPROTO_TCP, TCP_CORK, (char *)&opt, sizeof(opt)) != 0);
+#elif defined(TCP_NOPUSH)
+    return(setsockopt(netsockets[handle].socket, IPPROTO_TCP, TCP_NOPUSH, (char *)&opt, sizeof(opt)) != 0);
+#else
+    error(ERR_NET_NOTSUPP);
+#endif
+  default:
+    error(ERR_NET_NOTSUPP);
+  }
+  return(1);
+}
+
+/*
+** 'net_readiness' returns which of the NET_xxx conditions currently
+** hold for socket 'handle'. Data already in the receive buffer
+** counts as the socket being readable
+*/
+static int32 net_readiness(int handle) {
+  netsocket *sp = &netsockets[handle];
+  int32 ready = sp->ready;
+  if (sp->state == NETSTATE_FAILED) return(NET_READABLE | NET_HANGUP);
+  if (sp->state != NETSTATE_OPEN) return(0);
+  if (sp->bufptr < sp->bufendptr || sp->eof) ready |= NET_READABLE;
+  return(ready);
+}
+
+#ifdef TARGET_LINUX
+/*
+** 'net_collect' waits up to 'timeout' milliseconds for epoll to report
+** a change on any socket and records the new state of each one. If
+** there are more events than fit in one batch, the rest are collected
+** without waiting
+*/
+static void net_collect(int timeout) {
+  struct epoll_event events[MAXNETEVENTS];
+  int n, count, wakeup = 0;
+  uint32 ev;
+
+  do {
+    count = epoll_wait(netepoll, events, MAXNETEVENTS, timeout);
+    if (count == -1) {
+      if (errno == EINTR) return;
+      error(ERR_NET_NOTSUPP);
+    }
+    for (n=0; n<count; n++) {
+      netsocket *sp;
+      if (events[n].data.u32 == NETWAKEUP) {	/* A host name look-up has finished */
+        wakeup = 1;
+        continue;
+      }
+      sp = &netsockets[events[n].data.u32];
+      ev = events[n].events;
+      if (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) sp->ready |= NET_READABLE;
+      if (ev & EPOLLOUT) sp->ready |= NET_WRITABLE;
+      if (ev & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) sp->ready |= NET_HANGUP;
+      if (sp->state == NETSTATE_CONNECTING) finish_connect(events[n].data.u32);
+    }
+    timeout = 0;
+  } while (count == MAXNETEVENTS);
+  if (wakeup) net_progress();
+}
+#endif
+
+#ifdef TARGET_UNIX
+static void net_update(int handle) {
+  net_progress();
+#ifdef TARGET_LINUX
+  if (netepoll != -1) net_collect(0);
+#else
+  if (netsockets[handle].state == NETSTATE_CONNECTING) {
+    struct pollfd fd;
+    fd.fd = netsockets[handle].socket;
+    fd.events = POLLOUT;
+    fd.revents = 0;
+    if (poll(&fd, 1, 0) > 0) finish_connect(handle);
+  }
+#endif
+}
+
+/*
+** 'net_status' returns how far the connection for entry 'handle' in
+** the socket table has got: 0 if it is open, 1 if the host name is being
+** looked up, 2 if the connection is being made and -1 if it failed.
+** The number of the error that stopped it is stored at 'errnum'
+*/
+int32 net_status(int handle, int32 *errnum) {
+  netsocket *sp = &netsockets[handle];
+
+  net_update(handle);
+  *errnum = 0;
+  switch (sp->state) {
+  case NETSTATE_RESOLVING:
+    return(1);
+  case NETSTATE_CONNECTING:
+    return(2);
+  case NETSTATE_FAILED:
+    *errnum = get_equiverror(sp->errnum);
+    return(-1);
+  default:
+    return(0);
+  }
+}
+#endif
+
+/*
+** 'net_wait' waits until at least one of the 'count' sockets whose
+** socket table indexes are in 'handles' is ready in one of the ways
+** given by the NET_xxx bits in the corresponding entry of 'events'.
+** On return each entry of 'events' holds the conditions that are true
+** for that socket and the number of sockets that are ready is returned.
+** 'timeout' is the longest time to wait in centiseconds. If it is -1
+** the function waits until something happens.
+**
+** On Linux the sockets are kept in an epoll set so each call only
+** costs time in proportion to the number of sockets passed to it and
+** the number that have become ready. Elsewhere poll() is used
+*/
+int32 net_wait(int *handles, int32 *events, int32 count, int32 timeout) {
+  int32 n, found, ready;
+  int64 deadline = 0, remaining;
+#ifndef TARGET_LINUX
+#ifdef TARGET_UNIX
+  int32 want;
+  struct pollfd *fds;
+#endif
+#endif
+
+  net_flushall();	/* Whatever is being waited for may depend on pending output */
+  if (timeout > 0) deadline = mos_centiseconds()+timeout;
+#ifdef TARGET_LINUX
+  if (netepoll == -1) error(ERR_NET_NOTSUPP);
+  net_collect(0);
+  while (TRUE) {
+    found = 0;
+    for (n=0; n<count; n++) {
+      if (net_readiness(handles[n]) & (events[n] | NET_HANGUP)) found++;
+    }
+    if (found > 0 || timeout == 0) break;
+    if (timeout > 0) {
+      remaining = deadline-mos_centiseconds();
+      if (remaining <= 0) break;
+      net_collect(remaining*10);
+    } else {
+      net_collect(-1);
+    }
+    if (basicvars.escape) error(ERR_ESCAPE);
+  }
+  for (n=0; n<count; n++) {
+    ready = net_readiness(handles[n]);
+    events[n] = ready & (events[n] | NET_HANGUP);
+  }
+  return(found);
+#elif defined(TARGET_UNIX)
+  fds = malloc((count+1)*sizeof(struct pollfd));
+  if (fds == NIL) error(ERR_NOROOM);
+  while (TRUE) {
+    net_progress();
+    found = 0;
+    for (n=0; n<count; n++) {	/* Data already buffered is ready without asking */
+      if (net_readiness(handles[n]) & (events[n] | NET_HANGUP)) found++;
+    }
+    remaining = -1;
+    if (found > 0 || timeout == 0) remaining = 0;
+    else if (timeout > 0) {
+      remaining = deadline-mos_centiseconds();
+      if (remaining < 0) remaining = 0;
+      remaining = remaining*10;
+    }
+    for (n=0; n<count; n++) {
+      netsocket *sp = &netsockets[handles[n]];
+      fds[n].fd = sp->socket;
+      fds[n].events = 0;
+      fds[n].revents = 0;
+      if (sp->state == NETSTATE_CONNECTING)
+        fds[n].events = POLLOUT;
+      else if (sp->state == NETSTATE_OPEN) {
+        if (events[n] & NET_READABLE) fds[n].events |= POLLIN;
+        if (events[n] & NET_WRITABLE) fds[n].events |= POLLOUT;
+      } else {
+        fds[n].fd = -1;		/* Nothing to wait for. poll() ignores this entry */
+      }
+    }
+    fds[count].fd = netwakeup[0];	/* Wake up if a host name look-up finishes */
+    fds[count].events = POLLIN;
+    fds[count].revents = 0;
+    if (poll(fds, count+1, remaining) == -1 && errno != EINTR) {
+      free(fds);
+      error(ERR_NET_NOTSUPP);
+    }
+    if (basicvars.escape) {
+      free(fds);
+      error(ERR_ESCAPE);
+    }
+    found = 0;
+    for (n=0; n<count; n++) {
+      netsocket *sp = &netsockets[handles[n]];
+      want = events[n];
+      if (sp->state == NETSTATE_CONNECTING) {
+        ready = 0;
+        if (fds[n].revents) {
+          finish_connect(handles[n]);
+          if (sp->state == NETSTATE_OPEN) ready = NET_WRITABLE;
+        }
+        ready |= net_readiness(handles[n]);
+      } else {
+        ready = net_readiness(handles[n]);
+        if (fds[n].revents & POLLIN) ready |= NET_READABLE;
+        if (fds[n].revents & POLLOUT) ready |= NET_WRITABLE;
+        if (fds[n].revents & (POLLHUP | POLLERR)) ready |= NET_READABLE | NET_HANGUP;
+      }
+      if (ready & (want | NET_HANGUP)) found++;
+      fds[n].revents = ready & (want | NET_HANGUP);	/* Hold on to result until the end */
+    }
+    if (found > 0 || remaining == 0) break;
+  }
+  for (n=0; n<count; n++) events[n] = fds[n].revents;
+  free(fds);
+  return(found);
+#else
+  error(ERR_UNSUPPORTED);
+  return(0);
+#endif
+}
 #endif /* NONET ... right at top of the file */
@@ -19,14 +19,48 @@
 */
 #ifndef BRANDY_NET_H
 #define BRANDY_NET_H
+
+/* Conditions tested for and returned by 'net_wait' and 'fileio_wait' */
+#define NET_READABLE 1		/* Data can be read or connection can be accepted */
+#define NET_WRITABLE 2		/* Data can be written */
+#define NET_HANGUP 4		/* Connection has been closed or has failed */
+
+/* Operations carried out by 'net_control' */
+#define NETCTL_FLUSH 0		/* Send any buffered output */
+#define NETCTL_BUFFER 1		/* Turn output buffering on or off */
+#define NETCTL_NODELAY 2	/* Set TCP_NODELAY */
+#define NETCTL_CORK 3		/* Set TCP_CORK */
+
+/* Results returned by 'net_sendfile' and 'net_recvfile' */
+#define NETXFER_DONE 0		/* Everything asked for was transferred */
+#define NETXFER_END 1		/* End of file reached or connection closed first */
+#define NETXFER_ERROR 2		/* Transfer failed part way */
+
 #ifndef NONET
 #include "common.h"
 extern void brandynet_init();
 extern int brandynet_connect(char *dest, char type);
+extern int brandynet_listen(char *dest, char type);
+extern int brandynet_accept(int handle);
+extern int brandynet_udp(char *dest, char type);
 extern int brandynet_close(int handle);
 extern int32 net_bget(int handle);
 extern boolean net_eof(int handle);
+extern int32 net_getline(int handle, char *buffer, int32 size);
 extern int net_bput(int handle, int32 value);
 extern int net_bputstr(int handle, char *string, int32 length);
+extern int net_flush(int handle);
+extern void net_flushall(void);
+extern int32 net_sendbatch(int handle, char *data, int32 *lengths, int32 count);
+extern int32 net_recvbatch(int handle, char *buffer, int32 slotsize, int32 *lengths, int32 count);
+extern int32 net_sendfile(int handle, int fd, int64 offset, int64 count, int64 *done);
+#ifdef TARGET_UNIX
+extern int32 net_recvfile(int handle, int fd, int64 offset, int64 count, int64 *done);
+#endif
+extern int net_control(int handle, int32 reason, int32 value);
+#ifdef TARGET_UNIX
+extern int32 net_status(int handle, int32 *errnum);
+#endif
+extern int32 net_wait(int *handles, int32 *events, int32 count, int32 timeout);
 #endif /* NONET */
 #endif /* BRANDY_NET_H */
@@ -933,6 +933,9 @@ static void restore(int32 parmcount) {
         free_string(p->value.savedstring);
         break;
       case VAR_INTARRAY: case VAR_INT64ARRAY: case VAR_UINT8ARRAY: case VAR_FLOATARRAY: case VAR_STRARRAY:
+/* Discard the descriptor if the parameter was a slice of an array */
+        if (GET_TOPITEM==STACK_LOCARRAY
+         && *p->savedetails.address.arrayaddr==CAST(basicvars.stacktop.bytesp+ALIGNSIZE(stack_locarray), basicarray *)) free_stackmem();
         *p->savedetails.address.arrayaddr = p->value.savedarray;
         break;
       default:
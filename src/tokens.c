@@ -151,70 +151,73 @@ static token tokens [] = {
   {"DEG",       3, 2, TYPE_FUNCTION,    BASIC_TOKEN_DEG,      TYPE_FUNCTION, BASIC_TOKEN_DEG,       FALSE,  FALSE},
   {"DIM",       3, 3, TYPE_ONEBYTE,     BASIC_TOKEN_DIM,      TYPE_ONEBYTE, BASIC_TOKEN_DIM,        FALSE,  FALSE},
   {"DIV",       3, 2, TYPE_ONEBYTE,     BASIC_TOKEN_DIV,      TYPE_ONEBYTE, BASIC_TOKEN_DIV,        FALSE,  FALSE},
+  {"DOT(",      4, 4, TYPE_FUNCTION,    BASIC_TOKEN_DOT,      TYPE_FUNCTION, BASIC_TOKEN_DOT,       FALSE,  FALSE},
   {"DRAWBY",    6, 5, TYPE_ONEBYTE,     BASIC_TOKEN_DRAWBY,   TYPE_ONEBYTE, BASIC_TOKEN_DRAWBY,     FALSE,  FALSE},
   {"DRAW",      4, 2, TYPE_ONEBYTE,     BASIC_TOKEN_DRAW,     TYPE_ONEBYTE, BASIC_TOKEN_DRAW,       FALSE,  FALSE},
-  {"ELLIPSE",   7, 3, TYPE_ONEBYTE,     BASIC_TOKEN_ELLIPSE,  TYPE_ONEBYTE, BASIC_TOKEN_ELLIPSE,    FALSE,  FALSE}, /* 33 */
+  {"ELLIPSE",   7, 3, TYPE_ONEBYTE,     BASIC_TOKEN_ELLIPSE,  TYPE_ONEBYTE, BASIC_TOKEN_ELLIPSE,    FALSE,  FALSE}, /* 34 */
   {"ELSE",      4, 2, TYPE_ONEBYTE,     BASIC_TOKEN_XELSE,    TYPE_ONEBYTE, BASIC_TOKEN_XELSE,      FALSE,  TRUE},
   {"ENDCASE",   7, 4, TYPE_ONEBYTE,     BASIC_TOKEN_ENDCASE,  TYPE_ONEBYTE, BASIC_TOKEN_ENDCASE,    TRUE,   FALSE},
   {"ENDIF",     5, 4, TYPE_ONEBYTE,     BASIC_TOKEN_ENDIF,    TYPE_ONEBYTE, BASIC_TOKEN_ENDIF,      TRUE,   FALSE},
   {"ENDPROC",   7, 1, TYPE_ONEBYTE,     BASIC_TOKEN_ENDPROC,  TYPE_ONEBYTE, BASIC_TOKEN_ENDPROC,    TRUE,   FALSE},
-  {"ENDWHILE",  8, 4, TYPE_ONEBYTE,     BASIC_TOKEN_ENDWHILE, TYPE_ONEBYTE, BASIC_TOKEN_ENDWHILE,   TRUE,   FALSE}, /* 38 */
+  {"ENDWHILE",  8, 4, TYPE_ONEBYTE,     BASIC_TOKEN_ENDWHILE, TYPE_ONEBYTE, BASIC_TOKEN_ENDWHILE,   TRUE,   FALSE}, /* 39 */
   {"END",       3, 3, TYPE_ONEBYTE,     BASIC_TOKEN_END,      TYPE_ONEBYTE, BASIC_TOKEN_END,        TRUE,   FALSE},
   {"ENVELOPE",  8, 3, TYPE_ONEBYTE,     BASIC_TOKEN_ENVELOPE, TYPE_ONEBYTE, BASIC_TOKEN_ENVELOPE,   FALSE,  FALSE},
   {"EOF",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_EOF,      TYPE_FUNCTION, BASIC_TOKEN_EOF,       TRUE,   FALSE},
   {"EOR",       3, 3, TYPE_ONEBYTE,     BASIC_TOKEN_EOR,      TYPE_ONEBYTE, BASIC_TOKEN_EOR,        FALSE,  FALSE},
-  {"ERL",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_ERL,      TYPE_FUNCTION, BASIC_TOKEN_ERL,       TRUE,   FALSE}, /* 43 */
+  {"ERL",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_ERL,      TYPE_FUNCTION, BASIC_TOKEN_ERL,       TRUE,   FALSE}, /* 44 */
   {"ERROR",     5, 3, TYPE_ONEBYTE,     BASIC_TOKEN_ERROR,    TYPE_ONEBYTE, BASIC_TOKEN_ERROR,      FALSE,  FALSE},
   {"ERR",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_ERR,      TYPE_FUNCTION, BASIC_TOKEN_ERR,       TRUE,   FALSE},
   {"EVAL",      4, 2, TYPE_FUNCTION,    BASIC_TOKEN_EVAL,     TYPE_FUNCTION, BASIC_TOKEN_EVAL,      FALSE,  FALSE},
   {"EXP",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_EXP,      TYPE_FUNCTION, BASIC_TOKEN_EXP,       FALSE,  FALSE},
   {"EXT",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_EXT,      TYPE_FUNCTION, BASIC_TOKEN_EXT,       TRUE,   FALSE},
-  {"FALSE",     5, 2, TYPE_ONEBYTE,     BASIC_TOKEN_FALSE,    TYPE_ONEBYTE, BASIC_TOKEN_FALSE,      TRUE,   FALSE}, /* 49 */
+  {"FALSE",     5, 2, TYPE_ONEBYTE,     BASIC_TOKEN_FALSE,    TYPE_ONEBYTE, BASIC_TOKEN_FALSE,      TRUE,   FALSE}, /* 50 */
   {"FILEPATH$", 9, 4, TYPE_FUNCTION,    BASIC_TOKEN_FILEPATH, TYPE_FUNCTION, BASIC_TOKEN_FILEPATH,  FALSE,  FALSE},
   {"FILL",      4, 2, TYPE_ONEBYTE,     BASIC_TOKEN_FILL,     TYPE_ONEBYTE, BASIC_TOKEN_FILL,       FALSE,  FALSE},
   {"FN",        2, 2, TYPE_ONEBYTE,     BASIC_TOKEN_FN,       TYPE_ONEBYTE, BASIC_TOKEN_FN,         FALSE,  FALSE},
   {"FOR",       3, 1, TYPE_ONEBYTE,     BASIC_TOKEN_FOR,      TYPE_ONEBYTE, BASIC_TOKEN_FOR,        FALSE,  FALSE},
-  {"GCOL",      4, 2, TYPE_ONEBYTE,     BASIC_TOKEN_GCOL,     TYPE_ONEBYTE, BASIC_TOKEN_GCOL,       FALSE,  FALSE}, /* 54 */
+  {"GCOL",      4, 2, TYPE_ONEBYTE,     BASIC_TOKEN_GCOL,     TYPE_ONEBYTE, BASIC_TOKEN_GCOL,       FALSE,  FALSE}, /* 55 */
   {"GET$",      4, 2, TYPE_FUNCTION,    BASIC_TOKEN_GETDOL,   TYPE_FUNCTION, BASIC_TOKEN_GETDOL,    FALSE,  FALSE},
   {"GET",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_GET,      TYPE_FUNCTION, BASIC_TOKEN_GET,       FALSE,  FALSE},
   {"GOSUB",     5, 3, TYPE_ONEBYTE,     BASIC_TOKEN_GOSUB,    TYPE_ONEBYTE, BASIC_TOKEN_GOSUB,      FALSE,  TRUE},
   {"GOTO",      4, 1, TYPE_ONEBYTE,     BASIC_TOKEN_GOTO,     TYPE_ONEBYTE, BASIC_TOKEN_GOTO,       FALSE,  TRUE},
-  {"HIMEM",     5, 1, TYPE_FUNCTION,    BASIC_TOKEN_HIMEM,    TYPE_FUNCTION, BASIC_TOKEN_HIMEM,     TRUE,   FALSE}, /* 59 */
-  {"IF",        2, 2, TYPE_ONEBYTE,     BASIC_TOKEN_XIF,      TYPE_ONEBYTE, BASIC_TOKEN_XIF,        FALSE,  FALSE}, /* 60 */
+  {"HIMEM",     5, 1, TYPE_FUNCTION,    BASIC_TOKEN_HIMEM,    TYPE_FUNCTION, BASIC_TOKEN_HIMEM,     TRUE,   FALSE}, /* 60 */
+  {"IF",        2, 2, TYPE_ONEBYTE,     BASIC_TOKEN_XIF,      TYPE_ONEBYTE, BASIC_TOKEN_XIF,        FALSE,  FALSE}, /* 61 */
   {"INKEY$",    6, 3, TYPE_FUNCTION,    BASIC_TOKEN_INKEYDOL, TYPE_FUNCTION, BASIC_TOKEN_INKEYDOL,  FALSE, FALSE},
   {"INKEY",     5, 5, TYPE_FUNCTION,    BASIC_TOKEN_INKEY,    TYPE_FUNCTION, BASIC_TOKEN_INKEY,     FALSE,  FALSE},
   {"INPUT",     5, 1, TYPE_ONEBYTE,     BASIC_TOKEN_INPUT,    TYPE_ONEBYTE, BASIC_TOKEN_INPUT,      FALSE,  FALSE},
   {"INSTR(",    6, 3, TYPE_FUNCTION,    BASIC_TOKEN_INSTR,    TYPE_FUNCTION, BASIC_TOKEN_INSTR,     FALSE,  FALSE},
   {"INT",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_INT,      TYPE_FUNCTION, BASIC_TOKEN_INT,       FALSE,  FALSE},
-  {"LEFT$(",    6, 2, TYPE_FUNCTION,    BASIC_TOKEN_LEFT,     TYPE_FUNCTION, BASIC_TOKEN_LEFT,      FALSE,  FALSE}, /* 66 */
+  {"LEFT$(",    6, 2, TYPE_FUNCTION,    BASIC_TOKEN_LEFT,     TYPE_FUNCTION, BASIC_TOKEN_LEFT,      FALSE,  FALSE}, /* 67 */
   {"LEN",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_LEN,      TYPE_FUNCTION, BASIC_TOKEN_LEN,       FALSE,  FALSE},
   {"LET",       3, 3, TYPE_ONEBYTE,     BASIC_TOKEN_LET,      TYPE_ONEBYTE, BASIC_TOKEN_LET,        FALSE,  FALSE},
-  {"LIBRARY",   7, 3, TYPE_ONEBYTE,     BASIC_TOKEN_LIBRARY,  TYPE_ONEBYTE, BASIC_TOKEN_LIBRARY,    FALSE,  FALSE}, /* 69 */
+  {"LIBRARY",   7, 3, TYPE_ONEBYTE,     BASIC_TOKEN_LIBRARY,  TYPE_ONEBYTE, BASIC_TOKEN_LIBRARY,    FALSE,  FALSE}, /* 70 */
   {"LINE",      4, 3, TYPE_ONEBYTE,     BASIC_TOKEN_LINE,     TYPE_ONEBYTE, BASIC_TOKEN_LINE,       FALSE,  FALSE},
   {"LN",        2, 2, TYPE_FUNCTION,    BASIC_TOKEN_LN,       TYPE_FUNCTION, BASIC_TOKEN_LN,        FALSE,  FALSE},
   {"LOCAL",     5, 3, TYPE_ONEBYTE,     BASIC_TOKEN_LOCAL,    TYPE_ONEBYTE, BASIC_TOKEN_LOCAL,      FALSE,  FALSE},
   {"LOG",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_LOG,      TYPE_FUNCTION, BASIC_TOKEN_LOG,       FALSE,  FALSE},
   {"LOMEM",     5, 3, TYPE_FUNCTION,    BASIC_TOKEN_LOMEM,    TYPE_FUNCTION, BASIC_TOKEN_LOMEM,     TRUE,   FALSE},
-  {"MID$(",     5, 1, TYPE_FUNCTION,    BASIC_TOKEN_MID,      TYPE_FUNCTION, BASIC_TOKEN_MID,       FALSE,  FALSE}, /* 75 */
+  {"MID$(",     5, 1, TYPE_FUNCTION,    BASIC_TOKEN_MID,      TYPE_FUNCTION, BASIC_TOKEN_MID,       FALSE,  FALSE}, /* 76 */
+  {"MAX(",      4, 4, TYPE_FUNCTION,    BASIC_TOKEN_MAX,      TYPE_FUNCTION, BASIC_TOKEN_MAX,       FALSE,  FALSE},
+  {"MIN(",      4, 4, TYPE_FUNCTION,    BASIC_TOKEN_MIN,      TYPE_FUNCTION, BASIC_TOKEN_MIN,       FALSE,  FALSE},
   {"MODE",      4, 2, TYPE_ONEBYTE,     BASIC_TOKEN_MODE,     TYPE_ONEBYTE, BASIC_TOKEN_MODE,       FALSE,  FALSE},
   {"MOD",       3, 3, TYPE_ONEBYTE,     BASIC_TOKEN_MOD,      TYPE_ONEBYTE, BASIC_TOKEN_MOD,        FALSE,  FALSE},
   {"MOUSE",     5, 3, TYPE_ONEBYTE,     BASIC_TOKEN_MOUSE,    TYPE_ONEBYTE, BASIC_TOKEN_MOUSE,      FALSE,  FALSE},
   {"MOVEBY",    6, 6, TYPE_ONEBYTE,     BASIC_TOKEN_MOVEBY,   TYPE_ONEBYTE, BASIC_TOKEN_MOVEBY,     FALSE,  FALSE},
   {"MOVE",      4, 3, TYPE_ONEBYTE,     BASIC_TOKEN_MOVE,     TYPE_ONEBYTE, BASIC_TOKEN_MOVE,       FALSE,  FALSE},
-  {"NEXT",      4, 1, TYPE_ONEBYTE,     BASIC_TOKEN_NEXT,     TYPE_ONEBYTE, BASIC_TOKEN_NEXT,       FALSE,  FALSE}, /* 81 */
+  {"NEXT",      4, 1, TYPE_ONEBYTE,     BASIC_TOKEN_NEXT,     TYPE_ONEBYTE, BASIC_TOKEN_NEXT,       FALSE,  FALSE}, /* 84 */
   {"NOT",       3, 3, TYPE_ONEBYTE,     BASIC_TOKEN_NOT,      TYPE_ONEBYTE, BASIC_TOKEN_NOT,        FALSE,  FALSE},
-  {"OFF",       3, 3, TYPE_ONEBYTE,     BASIC_TOKEN_OFF,      TYPE_ONEBYTE, BASIC_TOKEN_OFF,        FALSE,  FALSE}, /* 83 */
+  {"OFF",       3, 3, TYPE_ONEBYTE,     BASIC_TOKEN_OFF,      TYPE_ONEBYTE, BASIC_TOKEN_OFF,        FALSE,  FALSE}, /* 86 */
   {"OF",        2, 2, TYPE_ONEBYTE,     BASIC_TOKEN_OF,       TYPE_ONEBYTE, BASIC_TOKEN_OF,         FALSE,  FALSE},
-  {"ON",        2, 2, TYPE_ONEBYTE,     BASIC_TOKEN_ON,       TYPE_ONEBYTE, BASIC_TOKEN_ON,         FALSE,  FALSE}, /* 85 */
+  {"ON",        2, 2, TYPE_ONEBYTE,     BASIC_TOKEN_ON,       TYPE_ONEBYTE, BASIC_TOKEN_ON,         FALSE,  FALSE}, /* 88 */
   {"OPENIN",    6, 2, TYPE_FUNCTION,    BASIC_TOKEN_OPENIN,   TYPE_FUNCTION, BASIC_TOKEN_OPENIN,    FALSE,  FALSE},
   {"OPENOUT",   7, 5, TYPE_FUNCTION,    BASIC_TOKEN_OPENOUT,  TYPE_FUNCTION, BASIC_TOKEN_OPENOUT,   FALSE,  FALSE},
   {"OPENUP",    6, 5, TYPE_FUNCTION,    BASIC_TOKEN_OPENUP,   TYPE_FUNCTION, BASIC_TOKEN_OPENUP,    FALSE,  FALSE},
   {"ORIGIN",    6, 2, TYPE_ONEBYTE,     BASIC_TOKEN_ORIGIN,   TYPE_ONEBYTE, BASIC_TOKEN_ORIGIN,     FALSE,  FALSE},
-  {"OR",        2, 2, TYPE_ONEBYTE,     BASIC_TOKEN_OR,       TYPE_ONEBYTE, BASIC_TOKEN_OR,         FALSE,  FALSE}, /* 90 */
+  {"OR",        2, 2, TYPE_ONEBYTE,     BASIC_TOKEN_OR,       TYPE_ONEBYTE, BASIC_TOKEN_OR,         FALSE,  FALSE}, /* 93 */
   {"OSCLI",     5, 2, TYPE_ONEBYTE,     BASIC_TOKEN_OSCLI,    TYPE_ONEBYTE, BASIC_TOKEN_OSCLI,      FALSE,  FALSE},
   {"OTHERWISE", 9, 2, TYPE_ONEBYTE,     BASIC_TOKEN_XOTHERWISE, TYPE_ONEBYTE, BASIC_TOKEN_XOTHERWISE, FALSE, FALSE},
   {"OVERLAY",   7, 2, TYPE_ONEBYTE,     BASIC_TOKEN_OVERLAY,  TYPE_ONEBYTE,   BASIC_TOKEN_OVERLAY,  FALSE,  FALSE},
-  {"PAGE",      4, 2, TYPE_FUNCTION,    BASIC_TOKEN_PAGE,     TYPE_FUNCTION, BASIC_TOKEN_PAGE,      TRUE,   FALSE}, /* 94 */
+  {"PAGE",      4, 2, TYPE_FUNCTION,    BASIC_TOKEN_PAGE,     TYPE_FUNCTION, BASIC_TOKEN_PAGE,      TRUE,   FALSE}, /* 97 */
   {"PI",        2, 2, TYPE_FUNCTION,    BASIC_TOKEN_PI,       TYPE_FUNCTION, BASIC_TOKEN_PI,        TRUE,   FALSE},
   {"PLOT",      4, 2, TYPE_ONEBYTE,     BASIC_TOKEN_PLOT,     TYPE_ONEBYTE, BASIC_TOKEN_PLOT,       FALSE,  FALSE},
   {"POINTTO",   7, 7, TYPE_ONEBYTE,     BASIC_TOKEN_POINTTO,  TYPE_ONEBYTE, BASIC_TOKEN_POINTTO,    FALSE,  FALSE},
@@ -222,74 +225,74 @@ static token tokens [] = {
   {"POINT(",    6, 2, TYPE_FUNCTION,    BASIC_TOKEN_POINTFN,  TYPE_FUNCTION, BASIC_TOKEN_POINTFN,   FALSE,  FALSE},
   {"POINT",     5, 5, TYPE_ONEBYTE,     BASIC_TOKEN_POINT,    TYPE_ONEBYTE, BASIC_TOKEN_POINT,      FALSE,  FALSE},
   {"POS",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_POS,      TYPE_FUNCTION, BASIC_TOKEN_POS,       TRUE,   FALSE},
-  {"PRINT",     5, 1, TYPE_ONEBYTE,     BASIC_TOKEN_PRINT,    TYPE_ONEBYTE, BASIC_TOKEN_PRINT,      FALSE,  FALSE}, /* 102 */
+  {"PRINT",     5, 1, TYPE_ONEBYTE,     BASIC_TOKEN_PRINT,    TYPE_ONEBYTE, BASIC_TOKEN_PRINT,      FALSE,  FALSE}, /* 105 */
   {"PROC",      4, 4, TYPE_ONEBYTE,     BASIC_TOKEN_PROC,     TYPE_ONEBYTE, BASIC_TOKEN_PROC,       FALSE,  FALSE},
   {"PTR",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_PTR,      TYPE_FUNCTION, BASIC_TOKEN_PTR,       TRUE,   FALSE},
-  {"QUIT",      4, 1, TYPE_ONEBYTE,     BASIC_TOKEN_QUIT,     TYPE_ONEBYTE, BASIC_TOKEN_QUIT,       TRUE,   FALSE}, /* 105 */
-  {"RAD",       3, 2, TYPE_FUNCTION,    BASIC_TOKEN_RAD,      TYPE_FUNCTION, BASIC_TOKEN_RAD,       FALSE,  FALSE}, /* 106 */
+  {"QUIT",      4, 1, TYPE_ONEBYTE,     BASIC_TOKEN_QUIT,     TYPE_ONEBYTE, BASIC_TOKEN_QUIT,       TRUE,   FALSE}, /* 108 */
+  {"RAD",       3, 2, TYPE_FUNCTION,    BASIC_TOKEN_RAD,      TYPE_FUNCTION, BASIC_TOKEN_RAD,       FALSE,  FALSE}, /* 109 */
   {"READ",      4, 3, TYPE_ONEBYTE,     BASIC_TOKEN_READ,     TYPE_ONEBYTE, BASIC_TOKEN_READ,       FALSE,  FALSE},
   {"RECTANGLE", 9, 3, TYPE_ONEBYTE,     BASIC_TOKEN_RECTANGLE, TYPE_ONEBYTE, BASIC_TOKEN_RECTANGLE, FALSE,  FALSE},
   {"REM",       3, 3, TYPE_ONEBYTE,     BASIC_TOKEN_REM,      TYPE_ONEBYTE, BASIC_TOKEN_REM,        FALSE,  FALSE},
   {"REPEAT",    6, 3, TYPE_ONEBYTE,     BASIC_TOKEN_REPEAT,   TYPE_ONEBYTE, BASIC_TOKEN_REPEAT,     FALSE,  FALSE},
   {"REPORT$",   7, 7, TYPE_FUNCTION,    BASIC_TOKEN_REPORTDOL, TYPE_FUNCTION, BASIC_TOKEN_REPORTDOL, FALSE, FALSE},
-  {"REPORT",    6, 4, TYPE_ONEBYTE,     BASIC_TOKEN_REPORT,   TYPE_ONEBYTE, BASIC_TOKEN_REPORT,     TRUE,   FALSE}, /* 112 */
+  {"REPORT",    6, 4, TYPE_ONEBYTE,     BASIC_TOKEN_REPORT,   TYPE_ONEBYTE, BASIC_TOKEN_REPORT,     TRUE,   FALSE}, /* 115 */
   {"RESTORE",   7, 3, TYPE_ONEBYTE,     BASIC_TOKEN_RESTORE,  TYPE_ONEBYTE, BASIC_TOKEN_RESTORE,    FALSE,  TRUE},
   {"RETURN",    6, 1, TYPE_ONEBYTE,     BASIC_TOKEN_RETURN,   TYPE_ONEBYTE, BASIC_TOKEN_RETURN,     TRUE,   FALSE},
   {"RIGHT$(",   7, 2, TYPE_FUNCTION,    BASIC_TOKEN_RIGHT,    TYPE_FUNCTION, BASIC_TOKEN_RIGHT,     FALSE,  FALSE},
   {"RND(",      4, 4, TYPE_FUNCTION,    BASIC_TOKEN_RNDPAR,   TYPE_FUNCTION, BASIC_TOKEN_RNDPAR,    FALSE,  FALSE},
   {"RND",       3, 2, TYPE_FUNCTION,    BASIC_TOKEN_RND,      TYPE_FUNCTION, BASIC_TOKEN_RND,       TRUE,   FALSE},
   {"RUN",       3, 2, TYPE_ONEBYTE,     BASIC_TOKEN_RUN,      TYPE_ONEBYTE, BASIC_TOKEN_RUN,        TRUE,   FALSE},
-  {"SGN",       3, 2, TYPE_FUNCTION,    BASIC_TOKEN_SGN,      TYPE_FUNCTION, BASIC_TOKEN_SGN,       FALSE,  FALSE}, /* 119 */
+  {"SGN",       3, 2, TYPE_FUNCTION,    BASIC_TOKEN_SGN,      TYPE_FUNCTION, BASIC_TOKEN_SGN,       FALSE,  FALSE}, /* 122 */
   {"SIN",       3, 2, TYPE_FUNCTION,    BASIC_TOKEN_SIN,      TYPE_FUNCTION, BASIC_TOKEN_SIN,       FALSE,  FALSE},
   {"SOUND",     5, 2, TYPE_ONEBYTE,     BASIC_TOKEN_SOUND,    TYPE_ONEBYTE, BASIC_TOKEN_SOUND,      FALSE,  FALSE},
   {"SPC",       3, 3, TYPE_PRINTFN,     BASIC_TOKEN_SPC,      TYPE_PRINTFN, BASIC_TOKEN_SPC,        FALSE,  FALSE},
-  {"SQR",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_SQR,      TYPE_FUNCTION, BASIC_TOKEN_SQR,       FALSE,  FALSE}, /* 123 */
+  {"SQR",       3, 3, TYPE_FUNCTION,    BASIC_TOKEN_SQR,      TYPE_FUNCTION, BASIC_TOKEN_SQR,       FALSE,  FALSE}, /* 126 */
   {"STEP",      4, 1, TYPE_ONEBYTE,     BASIC_TOKEN_STEP,     TYPE_ONEBYTE, BASIC_TOKEN_STEP,       FALSE,  FALSE},
   {"STEREO",    6, 4, TYPE_ONEBYTE,     BASIC_TOKEN_STEREO,   TYPE_ONEBYTE, BASIC_TOKEN_STEREO,     FALSE,  FALSE},
   {"STOP",      4, 3, TYPE_ONEBYTE,     BASIC_TOKEN_STOP,     TYPE_ONEBYTE, BASIC_TOKEN_STOP,       TRUE,   FALSE},
   {"STR$",      4, 3, TYPE_FUNCTION,    BASIC_TOKEN_STR,      TYPE_FUNCTION, BASIC_TOKEN_STR,       FALSE,  FALSE},
-  {"STRING$(",  8, 4, TYPE_FUNCTION,    BASIC_TOKEN_STRING,   TYPE_FUNCTION, BASIC_TOKEN_STRING,    FALSE,  FALSE}, /* 128 */
+  {"STRING$(",  8, 4, TYPE_FUNCTION,    BASIC_TOKEN_STRING,   TYPE_FUNCTION, BASIC_TOKEN_STRING,    FALSE,  FALSE}, /* 131 */
   {"SUM",       3, 2, TYPE_FUNCTION,    BASIC_TOKEN_SUM,      TYPE_FUNCTION, BASIC_TOKEN_SUM,       FALSE,  FALSE},
   {"SWAP",      4, 2, TYPE_ONEBYTE,     BASIC_TOKEN_SWAP,     TYPE_ONEBYTE, BASIC_TOKEN_SWAP,       FALSE,  FALSE},
   {"SYS(",      4, 4, TYPE_FUNCTION,    BASIC_TOKEN_SYSFN,    TYPE_FUNCTION, BASIC_TOKEN_SYSFN,     FALSE,  FALSE},
   {"SYS",       3, 3, TYPE_ONEBYTE,     BASIC_TOKEN_SYS,      TYPE_ONEBYTE, BASIC_TOKEN_SYS,        FALSE,  FALSE},
-  {"TAB(",      4, 4, TYPE_PRINTFN,     BASIC_TOKEN_TAB,      TYPE_PRINTFN, BASIC_TOKEN_TAB,        FALSE,  FALSE}, /* 133 */
+  {"TAB(",      4, 4, TYPE_PRINTFN,     BASIC_TOKEN_TAB,      TYPE_PRINTFN, BASIC_TOKEN_TAB,        FALSE,  FALSE}, /* 136 */
   {"TAN",       3, 1, TYPE_FUNCTION,    BASIC_TOKEN_TAN,      TYPE_FUNCTION, BASIC_TOKEN_TAN,       FALSE,  FALSE},
   {"TEMPO",     5, 2, TYPE_ONEBYTE,     BASIC_TOKEN_TEMPO,    TYPE_FUNCTION, BASIC_TOKEN_TEMPOFN,   FALSE,  FALSE},
   {"THEN",      4, 2, TYPE_ONEBYTE,     BASIC_TOKEN_THEN,     TYPE_ONEBYTE, BASIC_TOKEN_THEN,       FALSE,  TRUE},
   {"TIME",      4, 2, TYPE_FUNCTION,    BASIC_TOKEN_TIME,     TYPE_FUNCTION, BASIC_TOKEN_TIME,      TRUE,   FALSE},
-  {"TINT",      4, 3, TYPE_ONEBYTE,     BASIC_TOKEN_TINT,     TYPE_ONEBYTE, BASIC_TOKEN_TINT,       FALSE,  FALSE}, /* 138 */
+  {"TINT",      4, 3, TYPE_ONEBYTE,     BASIC_TOKEN_TINT,     TYPE_ONEBYTE, BASIC_TOKEN_TINT,       FALSE,  FALSE}, /* 141 */
   {"TO",        2, 3, TYPE_ONEBYTE,     BASIC_TOKEN_TO,       TYPE_ONEBYTE, BASIC_TOKEN_TO,         FALSE,  FALSE},
   {"TRACE",     5, 2, TYPE_ONEBYTE,     BASIC_TOKEN_TRACE,    TYPE_ONEBYTE, BASIC_TOKEN_TRACE,      FALSE,  FALSE},
   {"TRUE",      4, 3, TYPE_ONEBYTE,     BASIC_TOKEN_TRUE,     TYPE_ONEBYTE, BASIC_TOKEN_TRUE,       TRUE,   FALSE},
-  {"UNTIL",     5, 1, TYPE_ONEBYTE,     BASIC_TOKEN_UNTIL,    TYPE_ONEBYTE, BASIC_TOKEN_UNTIL,      FALSE,  FALSE}, /* 142 */
+  {"UNTIL",     5, 1, TYPE_ONEBYTE,     BASIC_TOKEN_UNTIL,    TYPE_ONEBYTE, BASIC_TOKEN_UNTIL,      FALSE,  FALSE}, /* 145 */
   {"USR",       3, 2, TYPE_FUNCTION,    BASIC_TOKEN_USR,      TYPE_FUNCTION, BASIC_TOKEN_USR,       FALSE,  FALSE},
-  {"VAL",       3, 2, TYPE_FUNCTION,    BASIC_TOKEN_VAL,      TYPE_FUNCTION, BASIC_TOKEN_VAL,       FALSE,  FALSE}, /* 144 */
+  {"VAL",       3, 2, TYPE_FUNCTION,    BASIC_TOKEN_VAL,      TYPE_FUNCTION, BASIC_TOKEN_VAL,       FALSE,  FALSE}, /* 147 */
   {"VDU",       3, 1, TYPE_ONEBYTE,     BASIC_TOKEN_VDU,      TYPE_ONEBYTE, BASIC_TOKEN_VDU,        FALSE,  FALSE},
   {"VERIFY(",   7, 2, TYPE_FUNCTION,    BASIC_TOKEN_VERIFY,   TYPE_FUNCTION, BASIC_TOKEN_VERIFY,    FALSE,  FALSE},
   {"VOICES",    6, 2, TYPE_ONEBYTE,     BASIC_TOKEN_VOICES,   TYPE_ONEBYTE, BASIC_TOKEN_VOICES,     FALSE,  FALSE},
   {"VOICE",     5, 5, TYPE_ONEBYTE,     BASIC_TOKEN_VOICE,    TYPE_ONEBYTE, BASIC_TOKEN_VOICE,      FALSE,  FALSE},
   {"VPOS",      4, 2, TYPE_FUNCTION,    BASIC_TOKEN_VPOS,     TYPE_FUNCTION, BASIC_TOKEN_VPOS,      TRUE,   FALSE},
-  {"WAIT",      4, 2, TYPE_ONEBYTE,     BASIC_TOKEN_WAIT,     TYPE_ONEBYTE, BASIC_TOKEN_WAIT,       TRUE,   FALSE}, /* 150 */
+  {"WAIT",      4, 2, TYPE_ONEBYTE,     BASIC_TOKEN_WAIT,     TYPE_ONEBYTE, BASIC_TOKEN_WAIT,       TRUE,   FALSE}, /* 153 */
   {"WHEN",      4, 3, TYPE_ONEBYTE,     BASIC_TOKEN_XWHEN,    TYPE_ONEBYTE, BASIC_TOKEN_XWHEN,      FALSE,  FALSE},
   {"WHILE",     5, 1, TYPE_ONEBYTE,     BASIC_TOKEN_XWHILE,   TYPE_ONEBYTE, BASIC_TOKEN_XWHILE,     FALSE,  FALSE},
   {"WIDTH",     5, 2, TYPE_ONEBYTE,     BASIC_TOKEN_WIDTH,    TYPE_ONEBYTE, BASIC_TOKEN_WIDTH,      FALSE,  FALSE},
-  {"XLATE$(",   7, 2, TYPE_FUNCTION,    BASIC_TOKEN_XLATEDOL, TYPE_FUNCTION, BASIC_TOKEN_XLATEDOL,  FALSE,  FALSE}, /* 154 */
+  {"XLATE$(",   7, 2, TYPE_FUNCTION,    BASIC_TOKEN_XLATEDOL, TYPE_FUNCTION, BASIC_TOKEN_XLATEDOL,  FALSE,  FALSE}, /* 157 */
 /*
 ** The following keywords are Basic commands. These can be entered in mixed case.
 ** Note that 'RUN' is also in here so that it can be entered in lower case too.
 ** Also note that in the case of commands where there is 'O' version, the
 ** 'O' version must come first, for example, EDITO must preceed EDIT
 */
-  {"APPEND",    6, 2, TYPE_COMMAND,     BASIC_TOKEN_APPEND,   TYPE_COMMAND, BASIC_TOKEN_APPEND,     FALSE,  FALSE}, /* 155 */
+  {"APPEND",    6, 2, TYPE_COMMAND,     BASIC_TOKEN_APPEND,   TYPE_COMMAND, BASIC_TOKEN_APPEND,     FALSE,  FALSE}, /* 158 */
   {"AUTO",      4, 2, TYPE_COMMAND,     BASIC_TOKEN_AUTO,     TYPE_COMMAND, BASIC_TOKEN_AUTO,       FALSE,  FALSE},
-  {"CRUNCH",    6, 2, TYPE_COMMAND,     BASIC_TOKEN_CRUNCH,   TYPE_COMMAND, BASIC_TOKEN_CRUNCH,     FALSE,  FALSE}, /* 157 */
-  {"DELETE",    6, 3, TYPE_COMMAND,     BASIC_TOKEN_DELETE,   TYPE_COMMAND, BASIC_TOKEN_DELETE,     FALSE,  FALSE}, /* 158 */
-  {"EDITO",     5, 5, TYPE_COMMAND,     BASIC_TOKEN_EDITO,    TYPE_COMMAND, BASIC_TOKEN_EDITO,      FALSE,  FALSE}, /* 159 */
+  {"CRUNCH",    6, 2, TYPE_COMMAND,     BASIC_TOKEN_CRUNCH,   TYPE_COMMAND, BASIC_TOKEN_CRUNCH,     FALSE,  FALSE}, /* 160 */
+  {"DELETE",    6, 3, TYPE_COMMAND,     BASIC_TOKEN_DELETE,   TYPE_COMMAND, BASIC_TOKEN_DELETE,     FALSE,  FALSE}, /* 161 */
+  {"EDITO",     5, 5, TYPE_COMMAND,     BASIC_TOKEN_EDITO,    TYPE_COMMAND, BASIC_TOKEN_EDITO,      FALSE,  FALSE}, /* 162 */
   {"EDIT",      4, 2, TYPE_COMMAND,     BASIC_TOKEN_EDIT,     TYPE_COMMAND, BASIC_TOKEN_EDIT,       FALSE,  FALSE},
-  {"HELP",      4, 2, TYPE_COMMAND,     BASIC_TOKEN_HELP,     TYPE_COMMAND, BASIC_TOKEN_HELP,       TRUE,   FALSE}, /* 161 */
-  {"INSTALL",   7, 5, TYPE_COMMAND,     BASIC_TOKEN_INSTALL,  TYPE_COMMAND, BASIC_TOKEN_INSTALL,    FALSE,  FALSE}, /* 162 */
-  {"LISTB",     5, 5, TYPE_COMMAND,     BASIC_TOKEN_LISTB,    TYPE_COMMAND, BASIC_TOKEN_LISTB,      FALSE,  FALSE}, /* 163 */
+  {"HELP",      4, 2, TYPE_COMMAND,     BASIC_TOKEN_HELP,     TYPE_COMMAND, BASIC_TOKEN_HELP,       TRUE,   FALSE}, /* 164 */
+  {"INSTALL",   7, 5, TYPE_COMMAND,     BASIC_TOKEN_INSTALL,  TYPE_COMMAND, BASIC_TOKEN_INSTALL,    FALSE,  FALSE}, /* 165 */
+  {"LISTB",     5, 5, TYPE_COMMAND,     BASIC_TOKEN_LISTB,    TYPE_COMMAND, BASIC_TOKEN_LISTB,      FALSE,  FALSE}, /* 166 */
   {"LISTIF",    6, 6, TYPE_COMMAND,     BASIC_TOKEN_LISTIF,   TYPE_COMMAND, BASIC_TOKEN_LISTIF,     FALSE,  FALSE},
   {"LISTL",     5, 5, TYPE_COMMAND,     BASIC_TOKEN_LISTL,    TYPE_COMMAND, BASIC_TOKEN_LISTL,      FALSE,  FALSE},
   {"LISTO",     5, 5, TYPE_COMMAND,     BASIC_TOKEN_LISTO,    TYPE_FUNCTION, BASIC_TOKEN_LISTOFN,   FALSE,  FALSE},
@@ -297,31 +300,31 @@ static token tokens [] = {
   {"LIST",      4, 1, TYPE_COMMAND,     BASIC_TOKEN_LIST,     TYPE_COMMAND, BASIC_TOKEN_LIST,       FALSE,  FALSE},
   {"LOAD",      4, 2, TYPE_COMMAND,     BASIC_TOKEN_LOAD,     TYPE_COMMAND, BASIC_TOKEN_LOAD,       FALSE,  FALSE},
   {"LVAR",      4, 3, TYPE_COMMAND,     BASIC_TOKEN_LVAR,     TYPE_COMMAND, BASIC_TOKEN_LVAR,       TRUE,   FALSE},
-  {"NEW",       3, 3, TYPE_COMMAND,     BASIC_TOKEN_NEW,      TYPE_COMMAND, BASIC_TOKEN_NEW,        TRUE,   FALSE}, /* 171 */
-  {"OLD",       3, 1, TYPE_COMMAND,     BASIC_TOKEN_OLD,      TYPE_COMMAND, BASIC_TOKEN_OLD,        TRUE,   FALSE}, /* 172 */
-  {"QUIT",      4, 1, TYPE_ONEBYTE,     BASIC_TOKEN_QUIT,     TYPE_ONEBYTE, BASIC_TOKEN_QUIT,       TRUE,   FALSE}, /* 173 */
-  {"RENUMBER",  8, 3, TYPE_COMMAND,     BASIC_TOKEN_RENUMBER, TYPE_COMMAND, BASIC_TOKEN_RENUMBER,   FALSE,  FALSE}, /* 174 */
+  {"NEW",       3, 3, TYPE_COMMAND,     BASIC_TOKEN_NEW,      TYPE_COMMAND, BASIC_TOKEN_NEW,        TRUE,   FALSE}, /* 174 */
+  {"OLD",       3, 1, TYPE_COMMAND,     BASIC_TOKEN_OLD,      TYPE_COMMAND, BASIC_TOKEN_OLD,        TRUE,   FALSE}, /* 175 */
+  {"QUIT",      4, 1, TYPE_ONEBYTE,     BASIC_TOKEN_QUIT,     TYPE_ONEBYTE, BASIC_TOKEN_QUIT,       TRUE,   FALSE}, /* 176 */
+  {"RENUMBER",  8, 3, TYPE_COMMAND,     BASIC_TOKEN_RENUMBER, TYPE_COMMAND, BASIC_TOKEN_RENUMBER,   FALSE,  FALSE}, /* 177 */
   {"RUN",       3, 2, TYPE_ONEBYTE,     BASIC_TOKEN_RUN,      TYPE_ONEBYTE, BASIC_TOKEN_RUN,        TRUE,   FALSE},
-  {"SAVEO",     5, 5, TYPE_COMMAND,     BASIC_TOKEN_SAVEO,    TYPE_COMMAND, BASIC_TOKEN_SAVEO,      FALSE,  FALSE}, /* 176 */
+  {"SAVEO",     5, 5, TYPE_COMMAND,     BASIC_TOKEN_SAVEO,    TYPE_COMMAND, BASIC_TOKEN_SAVEO,      FALSE,  FALSE}, /* 179 */
   {"SAVE",      4, 2, TYPE_COMMAND,     BASIC_TOKEN_SAVE,     TYPE_COMMAND, BASIC_TOKEN_SAVE,       FALSE,  FALSE},
-  {"TEXTLOAD",  8, 3, TYPE_COMMAND,     BASIC_TOKEN_TEXTLOAD, TYPE_COMMAND, BASIC_TOKEN_TEXTLOAD,   FALSE,  FALSE}, /* 178 */
+  {"TEXTLOAD",  8, 3, TYPE_COMMAND,     BASIC_TOKEN_TEXTLOAD, TYPE_COMMAND, BASIC_TOKEN_TEXTLOAD,   FALSE,  FALSE}, /* 181 */
   {"TEXTSAVEO", 9, 9, TYPE_COMMAND,     BASIC_TOKEN_TEXTSAVEO, TYPE_COMMAND, BASIC_TOKEN_TEXTSAVEO, FALSE,  FALSE},
   {"TEXTSAVE",  8, 5, TYPE_COMMAND,     BASIC_TOKEN_TEXTSAVE, TYPE_COMMAND, BASIC_TOKEN_TEXTSAVE,   FALSE,  FALSE},
   {"TWINO",     5, 2, TYPE_COMMAND,     BASIC_TOKEN_TWINO,    TYPE_COMMAND, BASIC_TOKEN_TWINO,      TRUE,   FALSE},
   {"TWIN",      4, 4, TYPE_COMMAND,     BASIC_TOKEN_TWIN,     TYPE_COMMAND, BASIC_TOKEN_TWIN,       TRUE,   FALSE},
-  {"ZZ",        1, 1, 0, 0, 0, 0, FALSE, FALSE}                                                         /* 183 */
+  {"ZZ",        1, 1, 0, 0, 0, 0, FALSE, FALSE}                                                         /* 186 */
 };
 
 #define TOKTABSIZE (sizeof(tokens)/sizeof(token))
 
 static int start_letter [] = {
-  0, 9, 13, 26, 33, 49, 54, 59, 60, NOKEYWORD, NOKEYWORD, 66, 75, 81, 83, 94,
-  105, 106, 119, 133, 142, 144, 150, 154, NOKEYWORD, NOKEYWORD
+  0, 9, 13, 26, 34, 50, 55, 60, 61, NOKEYWORD, NOKEYWORD, 67, 76, 84, 86, 97,
+  108, 109, 122, 136, 145, 147, 153, 157, NOKEYWORD, NOKEYWORD
 };
 
 static int command_start [] = { /* Starting positions for commands in 'tokens' */
-  155, NOKEYWORD, 157, 158, 159, NOKEYWORD, NOKEYWORD, 161, 162, NOKEYWORD,
-  NOKEYWORD, 163, NOKEYWORD, 171, 172, NOKEYWORD, 173, 174, 176, 178,
+  158, NOKEYWORD, 160, 161, 162, NOKEYWORD, NOKEYWORD, 164, 165, NOKEYWORD,
+  NOKEYWORD, 166, NOKEYWORD, 174, 175, NOKEYWORD, 176, 177, 179, 181,
   NOKEYWORD, NOKEYWORD, NOKEYWORD, NOKEYWORD, NOKEYWORD, NOKEYWORD
 };
 
@@ -1589,7 +1592,8 @@ static char *functionlist [] = {        /* Functions -> function name */
   "INT", "LEN", "LISTO", "LN", "LOG", "OPENIN","OPENOUT", "OPENUP",             /* 28..2F */
   "PI", "POINT(", "POS", "RAD", "REPORT$", "RETCODE", "RND", "SGN",             /* 30..37 */
   "SIN", "SQR", "STR$", "STRING$(", "SUM", "TAN", "TEMPO", "USR",               /* 38..3F */
-  "VAL", "VERIFY(", "VPOS", "SYS(", "RND(", "XLATE$("                           /* 40..45 */
+  "VAL", "VERIFY(", "VPOS", "SYS(", "RND(", "XLATE$(", "MIN(", "MAX(",          /* 40..47 */
+  "DOT("                                                                        /* 48 */
 };
 
 static char *printlist [] = {NIL, "SPC", "TAB("};
@@ -1746,7 +1750,7 @@ void expand(byte *line, char *text) {
       case TYPE_FUNCTION:       /* Built-in Function */
         lp++;
         token = *lp;
-        if (token>BASIC_TOKEN_XLATEDOL) error(ERR_BADPROG);
+        if (token>BASIC_TOKEN_LASTFN) error(ERR_BADPROG);
         count = expand_token(text, functionlist, token);
         break;
       case TYPE_COMMAND:
@@ -1786,6 +1790,22 @@ void set_dest(byte *tp, byte *dest) {
   basicvars.runflags.has_offsets = TRUE;
 }
 
+/*
+** 'set_intconst' replaces the item at 'tp' in the tokenised code with
+** the integer constant 'value'. The item replaced must be the same size
+** as an integer constant. This is used to replace the SWI name in a SYS
+** statement with its number once it has been looked up
+*/
+void set_intconst(byte *tp, int32 value) {
+  int n;
+  *tp = BASIC_TOKEN_INTCON;
+  for (n=0; n<INTSIZE; n++) {
+    tp++;
+    *tp = CAST(value, byte);
+    value = value>>BYTESHIFT;
+  }
+}
+
 /*
 ** 'set_address' is called to store a pointer in the tokenised code.
 ** 'tp' points *at the token before* where the address is to go and 'p'
@@ -2326,3 +2346,34 @@ int32 reformat(byte *tp, byte *tokenbuf, int32 ftype) {
   tokenize(line, tokenbuf, HASLINE, FALSE);
   return get_linelen(tokenbuf);
 }
+
+/*
+** 'token_checksum' returns a checksum of the keyword table. It is kept
+** with cached copies of tokenised programs so that a copy made by an
+** interpreter with different keywords or token values is never used,
+** even if both have the same version string. Only the table goes into
+** it so that the same source always gives the same checksum. Other
+** changes to the tokenised form need TOKCACHE_FORMAT in editor.c to
+** be changed
+*/
+uint32 token_checksum(void) {
+  static uint32 checksum = 0;
+  uint32 hash;
+  int n;
+  char *p;
+
+  if (checksum != 0) return checksum;
+  hash = 2166136261u;
+  for (n = 0; n < TOKTABSIZE; n++) {
+    for (p = tokens[n].name; *p != asc_NUL; p++) hash = (hash ^ (byte)*p) * 16777619u;
+    hash = (hash ^ tokens[n].minlength) * 16777619u;
+    hash = (hash ^ tokens[n].lhtype) * 16777619u;
+    hash = (hash ^ tokens[n].lhvalue) * 16777619u;
+    hash = (hash ^ tokens[n].type) * 16777619u;
+    hash = (hash ^ tokens[n].value) * 16777619u;
+    hash = (hash ^ tokens[n].alone) * 16777619u;
+    hash = (hash ^ tokens[n].linefollow) * 16777619u;
+  }
+  checksum = hash != 0 ? hash : 1;
+  return checksum;
+}
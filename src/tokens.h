@@ -343,7 +343,11 @@
 #define BASIC_TOKEN_VPOS	0x42u
 #define BASIC_TOKEN_SYSFN	0x43u	/* The function SYS( */
 #define BASIC_TOKEN_RNDPAR	0x44u	/* The function RND( */
-#define BASIC_TOKEN_XLATEDOL	0x45u	/* Must remain the last in the list */
+#define BASIC_TOKEN_XLATEDOL	0x45u
+#define BASIC_TOKEN_MIN		0x46u	/* The function MIN( */
+#define BASIC_TOKEN_MAX		0x47u	/* The function MAX( */
+#define BASIC_TOKEN_DOT		0x48u	/* The function DOT( */
+#define BASIC_TOKEN_LASTFN	BASIC_TOKEN_DOT	/* Must remain the last in the list */
 
 /*
 ** Print functions preceded with 0xFE
@@ -360,6 +364,7 @@ extern byte *skip_token(byte *);
 extern byte *skip_name(byte *);
 extern void set_dest(byte *, byte *);
 extern void set_address(byte *, void *);
+extern void set_intconst(byte *, int32);
 extern byte *get_srcaddr(byte *);
 extern void save_lineno(byte *, int32);
 extern int32 get_lineno(byte *);	/* Returns line number at start of line */
@@ -374,6 +379,7 @@ extern void resolve_linenums(byte *);
 extern void reset_linenums(byte *);
 extern int32 reformat(byte *, byte *, int32);
 extern boolean isempty(byte []);
+extern uint32 token_checksum(void);
 
 #define GET_INTVALUE(p) (*p | (*(p+1)<<8) | (*(p+2)<<16) | (*(p+3)<<24))
 #define GET_INT64VALUE(p) (int64)((int64)*p | ((int64)*(p+1)<<8) | ((int64)*(p+2)<<16) | ((int64)*(p+3)<<24) | ((int64)*(p+4)<<32) | ((int64)*(p+5)<<40) | ((int64)*(p+6)<<48) | ((int64)*(p+7)<<56))